@@ -0,0 +1,262 @@
+#ifndef _ADVERT_DECODERS_H_
+#define _ADVERT_DECODERS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "prst_data.h"
+
+// A borrowed view of the parts of a BLE advertisement the decoders look at.
+struct advert_t {
+    const char* name;
+    size_t name_len;
+    uint16_t service_uuid; // 16-bit service data UUID, 0 if absent or longer
+    const uint8_t* data; // service data payload
+    size_t len;
+    mac_addr_t address; // advertiser address, big-endian
+};
+
+// Each decoder is a type with two static functions:
+//   matches(advert)      cheap predicate on name, UUID and length
+//   decode(advert, out)  fills the common record, false if the payload is bad
+// The first decoder whose predicate matches owns the advert.
+
+static inline uint16_t read_be16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline uint16_t read_le16(const uint8_t* p)
+{
+    return (uint16_t)(p[1] << 8 | p[0]);
+}
+
+static inline bool advert_name_is(const advert_t& advert, const char* name)
+{
+    size_t len = strlen(name);
+    return advert.name_len == len && memcmp(advert.name, name, len) == 0;
+}
+
+// b-parasite adverts are named 🌱 and carry the protocol version in the top
+// nibble of the first service data byte.
+static const char* const BPARASITE_NAME = "\xf0\x9f\x8c\xb1";
+
+struct BParasiteV2Decoder {
+    static inline bool matches(const advert_t& advert)
+    {
+        return advert.len >= 16 && (advert.data[0] >> 4) == 2 && advert_name_is(advert, BPARASITE_NAME);
+    }
+
+    static inline bool decode(const advert_t& advert, prst_sensor_data_t& out)
+    {
+        if ((advert.data[0] & 0x01) && advert.len < 18)
+            return false;
+        out = prst_sensor_data_t::from_servicedata(advert.data);
+        // b-parasite uses random static addresses, which have the top two bits set.
+        return out.mac_addr.bytes[0] >= 0xc0 && out.batt_mv != 0;
+    }
+};
+
+// Protocol v1 has the same layout as v2, except that bytes 4-5 hold the
+// temperature in unsigned millidegrees rather than signed centidegrees.
+struct BParasiteV1Decoder {
+    static inline bool matches(const advert_t& advert)
+    {
+        return advert.len >= 16 && (advert.data[0] >> 4) == 1 && advert_name_is(advert, BPARASITE_NAME);
+    }
+
+    static inline bool decode(const advert_t& advert, prst_sensor_data_t& out)
+    {
+        const uint8_t* data = advert.data;
+        out.has_light_sensor = data[0] & 0x01;
+        if (out.has_light_sensor && advert.len < 18)
+            return false;
+        out.protocol = PROTOCOL_BPARASITE_V1;
+        out.protocol_version = 1;
+        out.has_soil_sensor = true;
+        out.run_counter = data[1] & 0x0f;
+        out.batt_mv = read_be16(data + 2);
+        out.temp_c = read_be16(data + 4) / 1000.0f;
+        out.humi = read_be16(data + 6);
+        out.soil_moisture = read_be16(data + 8);
+        for (int i = 0; i < 6; i++) {
+            out.mac_addr.bytes[i] = data[10 + i];
+        }
+        if (out.has_light_sensor)
+            out.light = read_be16(data + 16);
+        return out.mac_addr.bytes[0] >= 0xc0 && out.batt_mv != 0;
+    }
+};
+
+// BTHome v2 (https://bthome.io/format/): one device info byte followed by
+// object id / value pairs. Encrypted payloads are not supported.
+struct BTHomeV2Decoder {
+    static const uint16_t SERVICE_UUID = 0xfcd2;
+
+    static inline bool matches(const advert_t& advert)
+    {
+        return advert.service_uuid == SERVICE_UUID && advert.len >= 1;
+    }
+
+    // Returns the size of an object's value, or -1 if the id is not known and
+    // the rest of the payload cannot be walked.
+    static inline int object_len(uint8_t id)
+    {
+        switch (id) {
+        case 0x00: case 0x01: case 0x09: case 0x0f: case 0x10: case 0x11:
+        case 0x2e: case 0x2f: case 0x3a: case 0x46: case 0x57: case 0x58:
+        case 0x59: case 0x60:
+            return 1;
+        case 0x02: case 0x03: case 0x06: case 0x07: case 0x08: case 0x0c:
+        case 0x0d: case 0x0e: case 0x12: case 0x13: case 0x14: case 0x3c:
+        case 0x3d: case 0x3f: case 0x40: case 0x41: case 0x43: case 0x44:
+        case 0x45: case 0x47: case 0x48: case 0x49: case 0x4a: case 0x51:
+        case 0x52: case 0x56: case 0x5a: case 0x5d: case 0x5e: case 0x5f:
+            return 2;
+        case 0x04: case 0x05: case 0x0a: case 0x0b: case 0x42: case 0x4b:
+            return 3;
+        case 0x3e: case 0x4c: case 0x4d: case 0x4e: case 0x4f: case 0x50:
+        case 0x55: case 0x5b: case 0x5c:
+            return 4;
+        default:
+            // 0x15 - 0x2d are all one byte binary sensors.
+            if (id >= 0x15 && id <= 0x2d)
+                return 1;
+            return -1;
+        }
+    }
+
+    static inline bool decode(const advert_t& advert, prst_sensor_data_t& out)
+    {
+        const uint8_t* data = advert.data;
+        uint8_t device_info = data[0];
+        if ((device_info >> 5) != 2 || (device_info & 0x01))
+            return false;
+
+        out.protocol = PROTOCOL_BTHOME_V2;
+        out.protocol_version = 2;
+        out.mac_addr = advert.address;
+
+        bool has_measurement = false;
+        size_t pos = 1;
+        while (pos < advert.len) {
+            uint8_t id = data[pos++];
+            int len = object_len(id);
+            if (len < 0 || pos + len > advert.len)
+                break;
+            const uint8_t* value = data + pos;
+            switch (id) {
+            case 0x00:
+                out.run_counter = value[0];
+                break;
+            case 0x01:
+                // Only a percentage; map it onto the voltage range battery_pct() expects.
+                if (out.batt_mv == 0)
+                    out.batt_mv = 2200 + value[0] * 10;
+                break;
+            case 0x02:
+                out.temp_c = (int16_t)read_le16(value) / 100.0f;
+                has_measurement = true;
+                break;
+            case 0x45:
+                out.temp_c = (int16_t)read_le16(value) / 10.0f;
+                has_measurement = true;
+                break;
+            case 0x03:
+                out.humi = (uint32_t)read_le16(value) * 65535 / 10000;
+                break;
+            case 0x2e:
+                out.humi = (uint32_t)value[0] * 65535 / 100;
+                break;
+            case 0x05: {
+                uint32_t centilux = value[0] | value[1] << 8 | (uint32_t)value[2] << 16;
+                uint32_t lux = centilux / 100;
+                out.light = lux > 0xffff ? 0xffff : lux;
+                out.has_light_sensor = true;
+                break;
+            }
+            case 0x0c:
+                out.batt_mv = read_le16(value);
+                break;
+            case 0x14:
+                out.soil_moisture = (uint32_t)read_le16(value) * 65535 / 10000;
+                out.has_soil_sensor = true;
+                break;
+            case 0x2f:
+                out.soil_moisture = (uint32_t)value[0] * 65535 / 100;
+                out.has_soil_sensor = true;
+                break;
+            default:
+                break;
+            }
+            pos += len;
+        }
+        return has_measurement;
+    }
+};
+
+// Thermometers running the custom ATC firmware advertise on the Environmental
+// Sensing UUID, in either the original atc1441 (13 byte, big-endian) or the
+// pvvx (15 byte, little-endian) layout.
+struct AtcDecoder {
+    static const uint16_t SERVICE_UUID = 0x181a;
+
+    static inline bool matches(const advert_t& advert)
+    {
+        return advert.service_uuid == SERVICE_UUID && (advert.len == 13 || advert.len == 15);
+    }
+
+    static inline bool decode(const advert_t& advert, prst_sensor_data_t& out)
+    {
+        const uint8_t* data = advert.data;
+        out.protocol = PROTOCOL_ATC;
+        if (advert.len == 13) {
+            out.protocol_version = 1;
+            for (int i = 0; i < 6; i++) {
+                out.mac_addr.bytes[i] = data[i];
+            }
+            out.temp_c = (int16_t)read_be16(data + 6) / 10.0f;
+            out.humi = (uint32_t)data[8] * 65535 / 100;
+            out.batt_mv = read_be16(data + 10);
+            out.run_counter = data[12];
+        } else {
+            out.protocol_version = 2;
+            for (int i = 0; i < 6; i++) {
+                out.mac_addr.bytes[i] = data[5 - i];
+            }
+            out.temp_c = (int16_t)read_le16(data + 6) / 100.0f;
+            out.humi = (uint32_t)read_le16(data + 8) * 65535 / 10000;
+            out.batt_mv = read_le16(data + 10);
+            out.run_counter = data[13];
+        }
+        return out.mac_addr == advert.address;
+    }
+};
+
+// Compile-time list of decoders. decode() expands into a chain of inlined
+// predicate checks, tried in the order the decoders are listed.
+template <typename... Decoders>
+struct AdvertDecoderRegistry;
+
+template <>
+struct AdvertDecoderRegistry<> {
+    static inline bool decode(const advert_t&, prst_sensor_data_t&)
+    {
+        return false;
+    }
+};
+
+template <typename First, typename... Rest>
+struct AdvertDecoderRegistry<First, Rest...> {
+    static inline bool decode(const advert_t& advert, prst_sensor_data_t& out)
+    {
+        if (First::matches(advert))
+            return First::decode(advert, out);
+        return AdvertDecoderRegistry<Rest...>::decode(advert, out);
+    }
+};
+
+typedef AdvertDecoderRegistry<BParasiteV2Decoder, BParasiteV1Decoder, BTHomeV2Decoder, AtcDecoder> advert_decoders;
+
+#endif // _ADVERT_DECODERS_H_
@@ -5,33 +5,10 @@
 
 #include "battery_util.h"
 #include "M5EPD.h"
+#include "local_sensors.h"
+#include "widgets.h"
 #include <string>
 
-extern std::string FONT_FACE;
-extern int FONT_SIZE;
-extern int ROW_HEIGHT;
-extern int ROW_PADDING;
-
-void drawBattery(std::string battery)
-{
-    int width = 40;
-    int height = ROW_HEIGHT;
-    int bgcolor = 15;
-    int fgcolor = 0;
-    int fontSize = ROW_HEIGHT;
-    M5EPD_Canvas canvas(&M5.EPD);
-    canvas.loadFont(FONT_FACE.c_str(), SD);
-    canvas.createRender(fontSize, 256);
-
-    canvas.createCanvas(width, height);
-    canvas.fillCanvas(bgcolor);
-    canvas.setTextSize(fontSize);
-    canvas.setTextColor(fgcolor, bgcolor);
-    canvas.drawString(battery.c_str(), 0, 0);
-    canvas.pushCanvas(960 - width - ROW_PADDING, 0, UPDATE_MODE_A2);
-    canvas.deleteCanvas();
-}
-
 std::string battery_icon(float pct)
 {
     if (pct > 95)
@@ -61,7 +38,7 @@ std::string lastBattery;
 
 void showBattery()
 {
-    uint32_t vol = M5.getBatteryVoltage();
+    uint32_t vol = local_sensors.battery_mv();
     if (vol < 3300) {
         vol = 3300;
     } else if (vol > 4350) {
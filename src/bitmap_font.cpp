@@ -0,0 +1,173 @@
+#include "bitmap_font.h"
+
+#include "utf8.h"
+#include <cstring>
+
+BitmapFont font_atlas;
+
+static const char ATLAS_MAGIC[4] = { 'M', '5', 'F', 'A' };
+static const uint16_t ATLAS_VERSION = 1;
+static const size_t ATLAS_HEADER_LEN = 8;
+
+// True if `count` items of `size` bytes at `offset` fit in `len`.
+static bool in_bounds(size_t len, size_t offset, size_t count, size_t size)
+{
+    return offset <= len && count <= (len - offset) / size;
+}
+
+// Checks every table and glyph bitmap of a strike against the file, so draw()
+// can index them without further checks.
+bool BitmapFont::strike_valid(const uint8_t* buffer, size_t len, const strike_t& strike)
+{
+    if (!in_bounds(len, strike.glyphs, strike.glyph_count, sizeof(glyph_t))
+        || !in_bounds(len, strike.kerns, strike.kern_count, sizeof(kern_t)) || strike.bitmaps > len
+        || strike.glyphs % alignof(glyph_t) != 0 || strike.kerns % alignof(kern_t) != 0)
+        return false;
+    const glyph_t* glyphs = (const glyph_t*)(buffer + strike.glyphs);
+    for (uint16_t i = 0; i < strike.glyph_count; ++i) {
+        const glyph_t& glyph = glyphs[i];
+        size_t bitmap_len = glyph.height * ((glyph.width + 1) / 2);
+        if (glyph.bitmap > len - strike.bitmaps || bitmap_len > len - strike.bitmaps - glyph.bitmap)
+            return false;
+    }
+    return true;
+}
+
+bool BitmapFont::load(fs::FS& fs, const char* path)
+{
+    fs::File file = fs.open(path, FILE_READ);
+    if (!file)
+        return false;
+    size_t len = file.size();
+    uint8_t* buffer = (uint8_t*)ps_malloc(len);
+    if (buffer == nullptr) {
+        file.close();
+        return false;
+    }
+    bool ok = file.read(buffer, len) == len;
+    file.close();
+
+    uint16_t version = 0;
+    uint16_t strikes = 0;
+    if (ok && len >= ATLAS_HEADER_LEN && memcmp(buffer, ATLAS_MAGIC, 4) == 0) {
+        memcpy(&version, buffer + 4, 2);
+        memcpy(&strikes, buffer + 6, 2);
+    }
+    if (version != ATLAS_VERSION || ATLAS_HEADER_LEN + strikes * sizeof(strike_t) > len) {
+        free(buffer);
+        return false;
+    }
+    const strike_t* table = (const strike_t*)(buffer + ATLAS_HEADER_LEN);
+    for (uint16_t i = 0; i < strikes; ++i) {
+        if (!strike_valid(buffer, len, table[i])) {
+            free(buffer);
+            return false;
+        }
+    }
+
+    free(data);
+    data = buffer;
+    data_len = len;
+    strike_count = strikes;
+    return true;
+}
+
+const BitmapFont::strike_t* BitmapFont::find_strike(int size) const
+{
+    const strike_t* table = (const strike_t*)(data + ATLAS_HEADER_LEN);
+    for (uint16_t i = 0; i < strike_count; ++i) {
+        if (table[i].size == size)
+            return &table[i];
+    }
+    return nullptr;
+}
+
+const BitmapFont::glyph_t* BitmapFont::find_glyph(const strike_t* strike, uint32_t codepoint) const
+{
+    const glyph_t* glyphs = (const glyph_t*)(data + strike->glyphs);
+    size_t lo = 0;
+    size_t hi = strike->glyph_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (glyphs[mid].codepoint < codepoint)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < strike->glyph_count && glyphs[lo].codepoint == codepoint)
+        return &glyphs[lo];
+    return nullptr;
+}
+
+int BitmapFont::kerning(const strike_t* strike, uint32_t left, uint32_t right) const
+{
+    if (strike->kern_count == 0 || left > 0xffff || right > 0xffff)
+        return 0;
+    const kern_t* kerns = (const kern_t*)(data + strike->kerns);
+    uint32_t key = left << 16 | right;
+    size_t lo = 0;
+    size_t hi = strike->kern_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        uint32_t mid_key = (uint32_t)kerns[mid].left << 16 | kerns[mid].right;
+        if (mid_key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < strike->kern_count && kerns[lo].left == left && kerns[lo].right == right)
+        return kerns[lo].adjust;
+    return 0;
+}
+
+bool BitmapFont::covers(const char* text, int size) const
+{
+    if (data == nullptr)
+        return false;
+    const strike_t* strike = find_strike(size);
+    if (strike == nullptr)
+        return false;
+    while (uint32_t cp = next_codepoint(text)) {
+        if (find_glyph(strike, cp) == nullptr)
+            return false;
+    }
+    return true;
+}
+
+void BitmapFont::draw(M5EPD_Canvas& canvas, const char* text, int x, int y, int size, int fgcolor, int bgcolor) const
+{
+    if (data == nullptr)
+        return;
+    const strike_t* strike = find_strike(size);
+    if (strike == nullptr)
+        return;
+
+    const uint8_t* bitmaps = data + strike->bitmaps;
+    int baseline = y + strike->ascent;
+    int pen_x = x;
+    uint32_t prev = 0;
+    while (uint32_t cp = next_codepoint(text)) {
+        const glyph_t* glyph = find_glyph(strike, cp);
+        if (glyph == nullptr)
+            continue;
+        pen_x += kerning(strike, prev, cp);
+        prev = cp;
+
+        // The canvas was filled with bgcolor, so only covered pixels are written,
+        // blended between the background and foreground levels.
+        const uint8_t* row = bitmaps + glyph->bitmap;
+        int row_bytes = (glyph->width + 1) / 2;
+        int gx = pen_x + glyph->left;
+        int gy = baseline - glyph->top;
+        for (int j = 0; j < glyph->height; ++j, row += row_bytes) {
+            for (int i = 0; i < glyph->width; ++i) {
+                uint8_t coverage = (i & 1) ? row[i / 2] & 0x0f : row[i / 2] >> 4;
+                if (coverage == 0)
+                    continue;
+                int color = bgcolor + (fgcolor - bgcolor) * coverage / 15;
+                canvas.drawPixel(gx + i, gy + j, color);
+            }
+        }
+        pen_x += glyph->advance;
+    }
+}
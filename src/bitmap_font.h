@@ -0,0 +1,65 @@
+#ifndef _BITMAP_FONT_H_
+#define _BITMAP_FONT_H_
+
+#include <FS.h>
+#include <M5EPD.h>
+#include <cstddef>
+#include <cstdint>
+
+// Pre-rasterized glyph atlas built by tools/font_atlas.py. Holds one strike
+// of 4bpp antialiased glyphs per pixel size, so text can be blitted into a
+// canvas without loading and rasterizing the TTF.
+class BitmapFont {
+public:
+    // Read an atlas file into memory. Returns false if it is missing or invalid.
+    bool load(fs::FS& fs, const char* path);
+
+    // True if the atlas has a strike for `size` containing every character of `text`.
+    bool covers(const char* text, int size) const;
+
+    // Draw UTF-8 text with the top of its line box at (x, y). Characters
+    // missing from the atlas are skipped; check covers() first.
+    void draw(M5EPD_Canvas& canvas, const char* text, int x, int y, int size, int fgcolor, int bgcolor) const;
+
+private:
+    struct strike_t {
+        uint16_t size;
+        int16_t ascent;
+        int16_t descent;
+        uint16_t glyph_count;
+        uint16_t kern_count;
+        uint16_t reserved;
+        uint32_t glyphs;
+        uint32_t kerns;
+        uint32_t bitmaps;
+    };
+    struct glyph_t {
+        uint32_t codepoint;
+        uint8_t width;
+        uint8_t height;
+        int8_t left;
+        int8_t top;
+        uint8_t advance;
+        uint8_t reserved[3];
+        uint32_t bitmap;
+    };
+    struct kern_t {
+        uint16_t left;
+        uint16_t right;
+        int16_t adjust;
+        uint16_t reserved;
+    };
+
+    static bool strike_valid(const uint8_t* buffer, size_t len, const strike_t& strike);
+    const strike_t* find_strike(int size) const;
+    const glyph_t* find_glyph(const strike_t* strike, uint32_t codepoint) const;
+    int kerning(const strike_t* strike, uint32_t left, uint32_t right) const;
+
+    uint8_t* data = nullptr;
+    size_t data_len = 0;
+    uint16_t strike_count = 0;
+};
+
+extern BitmapFont font_atlas;
+
+#endif // _BITMAP_FONT_H_
@@ -6,7 +6,7 @@ bool has_key(const std::string& key, const std::map<std::string, std::string>& c
         return false;
     return true;
 }
-std::string value_or(const std::string& key, const std::map<std::string, std::string>& config, std::string default_val)
+std::string value_or(const std::string& key, const std::map<std::string, std::string>& config, const std::string& default_val)
 {
     if (!has_key(key, config))
         return default_val;
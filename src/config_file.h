@@ -12,4 +12,4 @@ static std::string trim_copy(std::string s);
 
 std::map<std::string, std::string> read_file_to_map(SDFile& in_file);
 bool has_key(const std::string& key, const std::map<std::string, std::string>& config);
-std::string value_or(const std::string& key, const std::map<std::string, std::string>& config, std::string default_val);
+std::string value_or(const std::string& key, const std::map<std::string, std::string>& config, const std::string& default_val);
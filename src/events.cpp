@@ -0,0 +1,25 @@
+#include "events.h"
+
+static EventGroupHandle_t event_group = nullptr;
+
+void initEvents()
+{
+    if (event_group == nullptr)
+        event_group = xEventGroupCreate();
+}
+
+void postEvent(EventBits_t bits)
+{
+    if (event_group != nullptr)
+        xEventGroupSetBits(event_group, bits);
+}
+
+EventBits_t waitForEvents(unsigned long timeout_ms)
+{
+    return xEventGroupWaitBits(event_group, EVENT_ALL, pdTRUE, pdFALSE, pdMS_TO_TICKS(timeout_ms)) & EVENT_ALL;
+}
+
+EventBits_t takeEvents()
+{
+    return xEventGroupClearBits(event_group, EVENT_ALL) & EVENT_ALL;
+}
@@ -0,0 +1,29 @@
+#ifndef _EVENTS_H_
+#define _EVENTS_H_
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+// Things that can wake the main loop. Posted from the BLE, WiFi, SNTP and
+// UDP tasks; the loop sleeps on them between frames.
+enum : EventBits_t {
+    EVENT_ADVERT = 1 << 0, // a decoded advert is waiting in new_sensors
+    EVENT_WIFI = 1 << 1, // WiFi connected or disconnected
+    EVENT_TIME = 1 << 2, // SNTP set the system clock
+    EVENT_SCAN_DONE = 1 << 3, // the BLE scan finished and needs restarting
+    EVENT_PEER = 1 << 4, // readings from another dashboard are waiting
+    EVENT_ALL = 0x1f,
+};
+
+void initEvents();
+void postEvent(EventBits_t bits);
+
+// Block until an event is posted or `timeout_ms` passes, and return (and
+// clear) whatever was posted.
+EventBits_t waitForEvents(unsigned long timeout_ms);
+
+// Return and clear pending events without blocking.
+EventBits_t takeEvents();
+
+#endif // _EVENTS_H_
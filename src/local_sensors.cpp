@@ -0,0 +1,96 @@
+#include "local_sensors.h"
+
+#include "time_util.h"
+#include <M5EPD.h>
+#include <algorithm>
+
+extern bool NTP_REFRESHED;
+
+LocalSensorSampler local_sensors;
+
+const size_t LocalSensorSampler::BATTERY_SAMPLES;
+
+void LocalSensorSampler::begin(unsigned long now)
+{
+    // The system clock starts at 1970 on every boot, so seed it from the RTC
+    // unless SNTP already answered while setup was connecting.
+    if (!NTP_REFRESHED)
+        setupSystemTime();
+    sample_sht30();
+    sample_battery();
+    last_rtc_sync = last_sht30 = last_battery = now;
+}
+
+void LocalSensorSampler::update(unsigned long now)
+{
+    if (now - last_sht30 >= sht30_interval) {
+        sample_sht30();
+        last_sht30 = now;
+    }
+    if (now - last_battery >= battery_interval) {
+        sample_battery();
+        last_battery = now;
+    }
+    if (now - last_rtc_sync >= rtc_sync_interval) {
+        sync_clock();
+        last_rtc_sync = now;
+    }
+}
+
+static unsigned long remaining(unsigned long now, unsigned long last, unsigned long interval)
+{
+    unsigned long elapsed = now - last;
+    return elapsed >= interval ? 0 : interval - elapsed;
+}
+
+unsigned long LocalSensorSampler::next_due(unsigned long now) const
+{
+    unsigned long due = remaining(now, last_sht30, sht30_interval);
+    due = std::min(due, remaining(now, last_battery, battery_interval));
+    due = std::min(due, remaining(now, last_rtc_sync, rtc_sync_interval));
+    return due;
+}
+
+bool LocalSensorSampler::local_time(struct tm* out) const
+{
+    time_t now = time(NULL);
+    return localtime_r(&now, out) != nullptr;
+}
+
+void LocalSensorSampler::sample_sht30()
+{
+    M5.SHT30.UpdateData();
+    float t = M5.SHT30.GetTemperature();
+    float h = M5.SHT30.GetRelHumidity();
+    if (!have_sht30) {
+        temp_c = t;
+        humi = h;
+        have_sht30 = true;
+        return;
+    }
+    temp_c += smoothing * (t - temp_c);
+    humi += smoothing * (h - humi);
+}
+
+void LocalSensorSampler::sample_battery()
+{
+    // The ADC reading is spiky under load; report the median of the last few.
+    batt_samples[batt_next] = M5.getBatteryVoltage();
+    batt_next = (batt_next + 1) % BATTERY_SAMPLES;
+    batt_count = std::min(batt_count + 1, BATTERY_SAMPLES);
+
+    uint32_t sorted[BATTERY_SAMPLES];
+    std::copy(batt_samples, batt_samples + batt_count, sorted);
+    std::sort(sorted, sorted + batt_count);
+    batt_mv = sorted[batt_count / 2];
+}
+
+void LocalSensorSampler::sync_clock()
+{
+    // Once SNTP has set the system clock it is the better source, so keep the
+    // RTC in step with it. Otherwise the RTC is the only source of time.
+    if (NTP_REFRESHED)
+        setupRTCTime();
+    else
+        setupSystemTime();
+}
@@ -0,0 +1,70 @@
+#ifndef _LOCAL_SENSORS_H_
+#define _LOCAL_SENSORS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+// Samples the M5Paper's own sensors (SHT30, battery ADC and RTC) at a
+// configurable rate per source and caches the results, so drawing code can
+// read them every pass without touching the I2C bus or the ADC.
+class LocalSensorSampler {
+public:
+    // Sampling periods in milliseconds.
+    unsigned long sht30_interval = 60 * 1000;
+    unsigned long battery_interval = 5 * 60 * 1000;
+    unsigned long rtc_sync_interval = 60 * 60 * 1000;
+
+    // Weight of a new SHT30 sample in the exponential moving average, 0..1.
+    float smoothing = 0.2f;
+
+    // Take a first sample from every source and seed the system clock from the RTC.
+    void begin(unsigned long now);
+
+    // Sample any source whose period has elapsed.
+    void update(unsigned long now);
+
+    // Milliseconds from now until update() next has work to do.
+    unsigned long next_due(unsigned long now) const;
+
+    float temperature_c() const
+    {
+        return temp_c;
+    }
+    float humidity() const
+    {
+        return humi;
+    }
+    uint32_t battery_mv() const
+    {
+        return batt_mv;
+    }
+
+    // Wall-clock time comes from the ESP32 system clock, which is only
+    // resynchronised with the RTC every rtc_sync_interval.
+    bool local_time(struct tm* out) const;
+
+private:
+    static const size_t BATTERY_SAMPLES = 5;
+
+    void sample_sht30();
+    void sample_battery();
+    void sync_clock();
+
+    unsigned long last_sht30 = 0;
+    unsigned long last_battery = 0;
+    unsigned long last_rtc_sync = 0;
+
+    float temp_c = 0;
+    float humi = 0;
+    bool have_sht30 = false;
+
+    uint32_t batt_samples[BATTERY_SAMPLES] = {};
+    size_t batt_count = 0;
+    size_t batt_next = 0;
+    uint32_t batt_mv = 0;
+};
+
+extern LocalSensorSampler local_sensors;
+
+#endif // _LOCAL_SENSORS_H_
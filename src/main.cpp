@@ -1,11 +1,23 @@
 #include "FS.h"
 #include "NimBLEDevice.h"
 #include "SPIFFS.h"
+#include "advert_decoders.h"
 #include "battery_util.h"
+#include "bitmap_font.h"
 #include "connect_wifi.h"
+#include "esp_sntp.h"
+#include "events.h"
 #include "init_mdns.h"
+#include "local_sensors.h"
+#include "peer_codec.h"
+#include "peer_sync.h"
 #include "prst_data.h"
+#include "render.h"
+#include "sensor_aliases.h"
+#include "sensor_stats.h"
+#include "state_store.h"
 #include "time_util.h"
+#include "widgets.h"
 #include <M5EPD.h>
 #include <WiFi.h>
 #include <cstddef>
@@ -20,22 +32,31 @@
 
 using namespace std;
 
-string FONT_FACE = "/default.ttf";
+extern string FONT_FACE;
 int FONT_SIZE = 42;
-int ROW_HEIGHT = 60;
-int ROW_PADDING = 5;
+extern int ROW_HEIGHT;
+extern int ROW_PADDING;
 unsigned REFRESH_INTERVAL = 1000;
 string WIFI_SSID;
 string WIFI_PASS;
 string HOSTNAME;
 int TEMPERATURE_CALIBRATION = 0;
 unsigned long SENSOR_TIMEOUT = 60 * 60 * 1000;
+unsigned long STALE_AFTER = 10 * 60 * 1000;
+unsigned long CHECKPOINT_INTERVAL = 5 * 60 * 1000;
+unsigned long DIAGNOSTICS_INTERVAL = 60 * 1000;
+unsigned SCAN_DURATION = 30;
+unsigned SYNC_PORT = 47811; // 0 disables sharing readings with other dashboards
+unsigned long SYNC_INTERVAL = 10 * 1000;
+// How long to wait after an advert for others in the same burst.
+const unsigned long COALESCE_WINDOW = 50;
+
+bool RENDER_DIAGNOSTICS = false;
+bool RENDER_SNAPSHOTS = false;
 
 bool WIFI_CONNECTED;
 bool NTP_REFRESHED;
-
-const int SCREEN_WIDTH = 960;
-const int SCREEN_HEIGHT = 540;
+bool QUIET_BOOT;
 
 rtc_time_t RTCtime;
 rtc_date_t RTCDate;
@@ -47,144 +68,224 @@ void wifi_connect()
         if (connected) {
             initMDNS(HOSTNAME.c_str());
             WIFI_CONNECTED = true;
+            beginPeerSync();
         } else {
             WIFI_CONNECTED = false;
         }
     }
 }
 
-void drawRow(const char* text, int y, int fontSize = 0, int fgcolor = 15, int bgcolor = 0)
+// Called on WiFi events rather than polled; the WiFi stack reconnects by itself.
+void wifi_state_changed()
+{
+    bool connected = WiFi.status() == WL_CONNECTED;
+    if (connected && !WIFI_CONNECTED) {
+        initMDNS(HOSTNAME.c_str());
+        beginPeerSync();
+    }
+    WIFI_CONNECTED = connected;
+}
+
+// Progress messages during setup are skipped when the panel still shows the
+// checkpointed dashboard.
+void bootStatus(const string& text, int row)
 {
-    M5EPD_Canvas canvas(&M5.EPD);
-    int margin = ROW_PADDING;
-    if (fontSize == 0)
-        fontSize = ROW_HEIGHT - margin * 2;
-
-    canvas.loadFont(FONT_FACE.c_str(), SD);
-    canvas.createRender(fontSize, 256);
-    canvas.createCanvas(SCREEN_WIDTH, ROW_HEIGHT);
-    canvas.fillCanvas(bgcolor);
-    canvas.setTextSize(fontSize);
-    canvas.setTextColor(fgcolor, bgcolor);
-    canvas.drawString(text, 20, margin);
-    canvas.pushCanvas(0, y, UPDATE_MODE_GLR16);
-    canvas.deleteCanvas();
+    if (!QUIET_BOOT)
+        drawRow(text, ROW_NUM(row));
 }
-void drawRow(const string& text, int y, int fontSize = 0, int fgcolor = 15, int bgcolor = 0)
+// Called before setup draws over the checkpointed dashboard. Until the next
+// full frame is checkpointed, a reset has to clear and redraw the panel.
+void leaveQuietBoot()
 {
-    drawRow(text.c_str(), y, fontSize, fgcolor, bgcolor);
+    QUIET_BOOT = false;
+    markDashboardOverwritten();
 }
-void drawHeader(const char* title, int y = 0, int fgcolor = 15, int bgcolor = 0)
+void bootError(const char* text)
 {
-    drawRow(title, y, ROW_HEIGHT, fgcolor, bgcolor);
+    leaveQuietBoot();
+    drawHeader(text);
+    delay(5000);
 }
-void drawHeader(const string& title, int y = 0, int fgcolor = 15, int bgcolor = 0)
+
+// Last drawn value of each header widget; widgets only redraw when it changes.
+extern char lastTime[];
+extern string lastBattery;
+string lastTemperature;
+int lastWiFi = -1;
+string lastCounts;
+
+// Force every header widget to redraw, e.g. after the panel was cleared.
+void forgetDrawnWidgets()
 {
-    drawHeader(title.c_str(), y, fgcolor, bgcolor);
+    lastTime[0] = '\0';
+    lastBattery.clear();
+    lastTemperature.clear();
+    lastWiFi = -1;
+    lastCounts.clear();
 }
 
 void showWiFi()
 {
-    int width = 50;
-    int height = ROW_HEIGHT;
-    int bgcolor = 15;
-    int fgcolor = 0;
-    int fontSize = 45;
-
-    wifi_connect();
-    string wifi_conn = WIFI_CONNECTED ? "直" : "睊";
-
-    M5EPD_Canvas canvas(&M5.EPD);
-    canvas.loadFont(FONT_FACE.c_str(), SD);
-    canvas.createRender(fontSize, 256);
-
-    canvas.createCanvas(width, height);
-    canvas.fillCanvas(bgcolor);
-    canvas.setTextSize(fontSize);
-    canvas.setTextColor(fgcolor, bgcolor);
-    canvas.drawString(wifi_conn.c_str(), 0, ROW_PADDING);
-    canvas.pushCanvas(SCREEN_WIDTH - 200 - width - ROW_PADDING, 0, UPDATE_MODE_A2);
-    canvas.deleteCanvas();
+    if (lastWiFi == WIFI_CONNECTED)
+        return;
+    lastWiFi = WIFI_CONNECTED;
+    drawWiFi(WIFI_CONNECTED);
 }
 
 void showTemperature()
 {
-    int width = 130;
-    int height = ROW_HEIGHT;
-    int bgcolor = 15;
-    int fgcolor = 0;
-    int fontSize = 45;
-
-    M5.SHT30.UpdateData();
-    float temp_c = M5.SHT30.GetTemperature();
+    float temp_c = local_sensors.temperature_c();
     float temp_f = (temp_c * 1.8) + 32.0;
     temp_f += TEMPERATURE_CALIBRATION;
     char temperature[10];
-    auto written = std::snprintf(temperature, 10, "%.0f°F", temp_f);
-
-    M5EPD_Canvas canvas(&M5.EPD);
-    canvas.loadFont(FONT_FACE.c_str(), SD);
-    canvas.createRender(fontSize, 256);
-
-    canvas.createCanvas(width, height);
-    canvas.fillCanvas(bgcolor);
-    canvas.setTextSize(fontSize);
-    canvas.setTextColor(fgcolor, bgcolor);
-    canvas.drawString(temperature, 0, ROW_PADDING);
-    canvas.pushCanvas(SCREEN_WIDTH - 50 - width - ROW_PADDING, 0, UPDATE_MODE_A2);
-    canvas.deleteCanvas();
+    std::snprintf(temperature, 10, "%.0f°F", temp_f);
+    if (lastTemperature == temperature)
+        return;
+    lastTemperature = temperature;
+    drawTemperature(temperature);
 }
 
 NimBLEScan* pBLEScan;
 unsigned seen_devices = 0;
-vector<prst_sensor_data_t> new_sensors;
+vector<prst_sensor_data_t> new_sensors; // filled by the BLE task, guarded by new_sensors_lock
+SemaphoreHandle_t new_sensors_lock;
 vector<prst_sensor_data_t> active_sensors;
-std::map<string, string> sensor_names;
+std::map<uint64_t, SensorStats> sensor_stats; // keyed by MAC, for sensors in active_sensors
 
 class AdvertisedDeviceCallbacks : public NimBLEAdvertisedDeviceCallbacks {
     void onResult(NimBLEAdvertisedDevice* advertisedDevice)
     {
         seen_devices += 1;
 
-        // This name decodes as 🌱
-        if (advertisedDevice->getName() != "\xf0\x9f\x8c\xb1")
-            return;
+        advert_t advert;
+        std::string name = advertisedDevice->getName();
+        advert.name = name.data();
+        advert.name_len = name.size();
+        // NimBLE stores addresses little-endian.
+        NimBLEAddress ble_address = advertisedDevice->getAddress();
+        const uint8_t* address = ble_address.getNative();
+        for (int i = 0; i < 6; i++) {
+            advert.address.bytes[i] = address[5 - i];
+        }
 
+        prst_sensor_data_t sensor_data;
+        bool decoded = false;
         auto numSDs = advertisedDevice->getServiceDataCount();
-        if (numSDs != 1)
-            return;
-
-        char service_data[20];
-        strncpy(service_data, advertisedDevice->getServiceData(0).c_str(), 20);
-        auto sensor_data = prst_sensor_data_t::from_servicedata((uint8_t*)service_data);
-
-        if (sensor_data.mac_addr.bytes[0] < 0xc0)
-            return;
-        if (sensor_data.batt_mv == 0)
+        for (size_t i = 0; i < numSDs && !decoded; i++) {
+            std::string service_data = advertisedDevice->getServiceData(i);
+            NimBLEUUID uuid = advertisedDevice->getServiceDataUUID(i);
+            advert.service_uuid = uuid.bitSize() == 16 ? uuid.getNative()->u16.value : 0;
+            advert.data = (const uint8_t*)service_data.data();
+            advert.len = service_data.size();
+            decoded = advert_decoders::decode(advert, sensor_data);
+            if (!decoded)
+                sensor_data = prst_sensor_data_t();
+        }
+        if (!decoded)
             return;
 
-        sensor_data.alias = value_or(sensor_data.mac_addr.to_str(), sensor_names, "");
+        sensor_data.alias_id = sensor_aliases.find(sensor_data.mac_addr.to_u64());
+        sensor_data.rssi = advertisedDevice->getRSSI();
 
+        xSemaphoreTake(new_sensors_lock, portMAX_DELAY);
         new_sensors.push_back(sensor_data);
+        xSemaphoreGive(new_sensors_lock);
+        postEvent(EVENT_ADVERT);
     }
 };
 
+void scanEnded(NimBLEScanResults results)
+{
+    postEvent(EVENT_SCAN_DONE);
+}
+
+// Runs on the SNTP task once the system clock has really been set.
+void timeSynced(struct timeval* tv)
+{
+    NTP_REFRESHED = true;
+    postEvent(EVENT_TIME);
+}
+
+void wifiEvent(WiFiEvent_t event)
+{
+    postEvent(EVENT_WIFI);
+}
+
+unsigned drawn_rows = 0;
+// What each sensor row shows, so rows that did not change are not pushed again.
+vector<string> drawn_lines;
+vector<int> drawn_colors;
+
+// Draw one row per active sensor, blanking rows left over from sensors that
+// have since timed out.
+void drawSensorRows()
+{
+    unsigned long now = millis();
+    size_t rows = max((size_t)drawn_rows, active_sensors.size());
+    drawn_lines.resize(rows);
+    drawn_colors.resize(rows, -1);
+
+    unsigned idx = 0;
+    for (const auto& sensor : active_sensors) {
+        const size_t line_len = 64;
+        char line[line_len];
+        sensor.to_str(line, line_len);
+        // Smoothed RSSI and the share of adverts lost over the stats window.
+        char indicator[16] = "";
+        auto stats = sensor_stats.find(sensor.mac_addr.to_u64());
+        if (stats != sensor_stats.end() && stats->second.samples() > 0) {
+            snprintf(indicator, sizeof(indicator), "%4.0f %2.0f%%", stats->second.rssi(),
+                stats->second.loss_rate() * 100.0f);
+        }
+        // Readings that have not been refreshed in a while are drawn in grey.
+        int fgcolor = now - sensor.timestamp > STALE_AFTER ? 8 : 15;
+        string drawn = string(line) + '\t' + indicator;
+        if (drawn_lines[idx] != drawn || drawn_colors[idx] != fgcolor) {
+            drawSensorRow(line, indicator, (idx + 2) * (ROW_HEIGHT + ROW_PADDING), fgcolor);
+            drawn_lines[idx] = drawn;
+            drawn_colors[idx] = fgcolor;
+        }
+        ++idx;
+    }
+    for (; idx < drawn_rows; ++idx) {
+        drawRow("", (idx + 2) * (ROW_HEIGHT + ROW_PADDING), 30);
+    }
+    drawn_rows = active_sensors.size();
+    drawn_lines.resize(drawn_rows);
+    drawn_colors.resize(drawn_rows);
+}
+
 void setup()
 {
     M5.begin();
     M5.RTC.begin();
     M5.EPD.SetRotation(0);
-    M5.EPD.Clear(true);
 
-    if (!SD.begin()) {
-        drawHeader("Failed to start filesystem");
-        delay(5000);
+    initEvents();
+    new_sensors_lock = xSemaphoreCreateMutex();
+    WiFi.onEvent(wifiEvent);
+    sntp_set_time_sync_notification_cb(timeSynced);
+
+    bool sd_ready = SD.begin();
+    // E-paper keeps its image without power, so if the last checkpoint was
+    // taken with the dashboard fully drawn the panel is still showing it and
+    // the full clear can be skipped. A setup that was interrupted leaves boot
+    // messages on the panel instead.
+    QUIET_BOOT = sd_ready && loadState() && stateShowsDashboard();
+    if (!QUIET_BOOT) {
+        leaveQuietBoot();
+        M5.EPD.Clear(true);
+    }
+
+    if (!sd_ready) {
+        bootError("Failed to start filesystem");
     } else {
-        drawHeader("Loading...", 0, 0, 15);
+        if (!QUIET_BOOT)
+            drawHeader("Loading...", 0, 0, 15);
 
         SDFile config_file = SD.open("/config.txt", FILE_READ);
         if (config_file.available()) {
-            drawRow("Reading config.txt", ROW_NUM(1));
+            bootStatus("Reading config.txt", 1);
             auto config_data = read_file_to_map(config_file);
             FONT_FACE = string("/") + value_or("font_face", config_data, FONT_FACE);
             FONT_SIZE = has_key("font_size", config_data) ? stoi(config_data["font_size"]) : FONT_SIZE;
@@ -193,143 +294,278 @@ void setup()
             TEMPERATURE_CALIBRATION = has_key("temperature_calibration", config_data)
                 ? stoi(config_data["temperature_calibration"])
                 : TEMPERATURE_CALIBRATION;
+            SCAN_DURATION = has_key("scan_duration", config_data) ? stoi(config_data["scan_duration"]) : SCAN_DURATION;
+            SYNC_PORT = has_key("sync_port", config_data) ? stoi(config_data["sync_port"]) : SYNC_PORT;
+            SYNC_INTERVAL = has_key("sync_interval", config_data) ? stoi(config_data["sync_interval"]) * 1000 : SYNC_INTERVAL;
             REFRESH_INTERVAL = has_key("refresh_interval", config_data) ? stoi(config_data["refresh_interval"]) : REFRESH_INTERVAL;
             SENSOR_TIMEOUT = has_key("sensor_timeout", config_data) ? stoi(config_data["sensor_timeout"]) * 1000 : SENSOR_TIMEOUT;
+            local_sensors.sht30_interval = has_key("sht30_interval", config_data)
+                ? stoi(config_data["sht30_interval"]) * 1000
+                : local_sensors.sht30_interval;
+            local_sensors.battery_interval = has_key("battery_interval", config_data)
+                ? stoi(config_data["battery_interval"]) * 1000
+                : local_sensors.battery_interval;
+            local_sensors.rtc_sync_interval = has_key("rtc_sync_interval", config_data)
+                ? stoi(config_data["rtc_sync_interval"]) * 1000
+                : local_sensors.rtc_sync_interval;
+            local_sensors.smoothing = has_key("temperature_smoothing", config_data)
+                ? stof(config_data["temperature_smoothing"])
+                : local_sensors.smoothing;
+            STALE_AFTER = has_key("sensor_stale", config_data) ? stoi(config_data["sensor_stale"]) * 1000 : STALE_AFTER;
+            CHECKPOINT_INTERVAL = has_key("checkpoint_interval", config_data)
+                ? stoi(config_data["checkpoint_interval"]) * 1000
+                : CHECKPOINT_INTERVAL;
+            RENDER_DIAGNOSTICS = has_key("render_diagnostics", config_data) ? stoi(config_data["render_diagnostics"]) != 0 : RENDER_DIAGNOSTICS;
+            RENDER_SNAPSHOTS = has_key("render_snapshots", config_data) ? stoi(config_data["render_snapshots"]) != 0 : RENDER_SNAPSHOTS;
+            if (has_key("font_atlas", config_data)) {
+                // Prefer a copy in the SPIFFS flash partition over the SD card.
+                string atlas = string("/") + config_data["font_atlas"];
+                if (!(SPIFFS.begin() && font_atlas.load(SPIFFS, atlas.c_str())))
+                    font_atlas.load(SD, atlas.c_str());
+            }
         } else {
-            drawHeader("Failed to open config.txt");
-            delay(5000);
+            bootError("Failed to open config.txt");
+        }
+
+        SDFile sensor_file = SD.open("/sensors.txt", FILE_READ);
+        if (sensor_file.available()) {
+            bootStatus("Reading sensors.txt", 1);
+            auto sensor_data = read_file_to_map(sensor_file);
+            int idx = 1;
+            // Readings without a MAC get a placeholder alias, which is not
+            // part of the configured list shown below.
+            auto aliases = sensor_data;
+            aliases["00-00-00-00-00-00"] = "<< no mac >>";
+            sensor_aliases.build(aliases);
+            for (const auto& pair : sensor_data) {
+                bootStatus(pair.first + string(" => ") + pair.second, idx++);
+            }
+            if (!QUIET_BOOT)
+                delay(5000);
+        } else {
+            bootError("Failed to open sensors.txt");
+        }
+
+        // Show the checkpointed readings before the slow WiFi and NTP setup.
+        if (QUIET_BOOT && !stateMatchesLayout(ROW_HEIGHT, ROW_PADDING)) {
+            leaveQuietBoot();
+            M5.EPD.Clear(true);
+        }
+        restoreSensors(active_sensors, millis(), SENSOR_TIMEOUT, STALE_AFTER);
+        if (QUIET_BOOT) {
+            drawn_rows = stateDrawnRows();
+            local_sensors.begin(millis());
+            showDateTime();
+            showBattery();
+            showTemperature();
+            drawSensorRows();
         }
 
         SDFile wifi_file = SD.open("/wifi.txt", FILE_READ);
         if (wifi_file.available()) {
-            drawRow("Reading wifi.txt", ROW_NUM(1));
+            bootStatus("Reading wifi.txt", 1);
             auto wifi_data = read_file_to_map(wifi_file);
             WIFI_SSID = value_or("wifi_ssid", wifi_data, "");
             WIFI_PASS = value_or("wifi_password", wifi_data, "");
 
             HOSTNAME = value_or("hostname", wifi_data, "bprst-monitor");
-            drawRow((string("Connecting to: '") + WIFI_SSID + "'"), ROW_NUM(2));
+            bootStatus(string("Connecting to: '") + WIFI_SSID + "'", 2);
             wifi_connect();
         } else {
-            drawHeader("Failed to open wifi.txt");
-            delay(5000);
+            bootError("Failed to open wifi.txt");
         }
 
         SDFile tz_file = SD.open("/tz.txt", FILE_READ);
         if (tz_file.available()) {
-            drawRow("Reading tz.txt", ROW_NUM(1));
+            bootStatus("Reading tz.txt", 1);
             auto tz_data = read_file_to_map(tz_file);
             string tz = value_or("tz", tz_data, "MST7MDT,M3.2.0,M11.1.0");
             string ntp_server_1 = value_or("ntp_server_1", tz_data, "pool.ntp.org");
             string ntp_server_2 = value_or("ntp_server_2", tz_data, "time.nist.gov");
             string ntp_server_3 = value_or("ntp_server_3", tz_data, "time.google.com");
-            NTP_REFRESHED = false;
             if (!(tz.empty()) && WIFI_CONNECTED) {
                 configTime(0, 0, ntp_server_1.c_str(), ntp_server_2.c_str(), ntp_server_3.c_str());
                 configTzTime(tz.c_str(), ntp_server_1.c_str(), ntp_server_2.c_str(), ntp_server_3.c_str());
-                NTP_REFRESHED = true;
+                // Give SNTP a chance to answer before the first frame; timeSynced
+                // records whether it did.
                 delay(2000);
             }
         } else {
-            drawHeader("Failed to open tz.txt");
-            delay(5000);
-        }
-
-        SDFile sensor_file = SD.open("/sensors.txt", FILE_READ);
-        if (sensor_file.available()) {
-            drawRow("Reading sensors.txt", ROW_NUM(1));
-            auto sensor_data = read_file_to_map(sensor_file);
-            int idx = 1;
-            sensor_names["00-00-00-00-00-00"] = "<< no mac >>";
-            for (const auto& pair : sensor_data) {
-                sensor_names[pair.first] = pair.second;
-                drawRow((pair.first + string(" => ") + pair.second).c_str(), ROW_NUM(idx++));
-            }
-            delay(5000);
-        } else {
-            drawHeader("Failed to open sensors.txt");
-            delay(5000);
+            bootError("Failed to open tz.txt");
         }
     }
 
-    setupRTCTime();
+    local_sensors.begin(millis());
 
-    NimBLEDevice::setScanFilterMode(CONFIG_BTDM_SCAN_DUPL_TYPE_DEVICE);
+    // Filter on address and data, so each new reading is reported once rather
+    // than each device once per scan; advert loss is measured from the run
+    // counters of these reports. Repeats that slip past the cache are dropped by
+    // SensorStats::add().
+    NimBLEDevice::setScanFilterMode(CONFIG_BTDM_SCAN_DUPL_TYPE_DATA_DEVICE);
     NimBLEDevice::setScanDuplicateCacheSize(200);
     NimBLEDevice::init("");
     pBLEScan = NimBLEDevice::getScan(); // create new scan
-    // Set the callback for when devices are discovered, no duplicates.
+    // Set the callback for each new advert, no repeats of the same data.
     pBLEScan->setAdvertisedDeviceCallbacks(new AdvertisedDeviceCallbacks(), false);
     pBLEScan->setActiveScan(true); // Set active scanning, this will get more data from the advertiser.
     pBLEScan->setInterval(97); // How often the scan occurs / switches channels; in milliseconds,
     pBLEScan->setWindow(37); // How long to scan during the interval; in milliseconds.
     pBLEScan->setMaxResults(0); // do not store the scan results, use callback only.
 
-    M5.EPD.Clear(true);
+    if (RENDER_SNAPSHOTS && !enableRenderSnapshots()) {
+        RENDER_SNAPSHOTS = false;
+    }
 
-    drawHeader("", ROW_NUM(0), 0, 15);
-    showDateTime();
-    showBattery();
-    showTemperature();
-    drawHeader("Devices", ROW_NUM(1), 0, 10);
+    if (!QUIET_BOOT) {
+        drawn_rows = 0;
+        drawn_lines.clear();
+        drawn_colors.clear();
+        forgetDrawnWidgets();
+        M5.EPD.Clear(true);
+        drawHeader("", ROW_NUM(0), 0, 15);
+        showDateTime();
+        showBattery();
+        showTemperature();
+        drawHeader("Devices", ROW_NUM(1), 0, 10);
+    }
+
+    pBLEScan->start(SCAN_DURATION, scanEnded, false);
 }
 
 void showDeviceCounts()
 {
-    char seen_str[16];
-    sprintf(seen_str, "%4d seen", (int)(seen_devices));
-    char valid_str[16];
-    sprintf(valid_str, "%4d valid", (int)(active_sensors.size()));
-
-    int width = 400;
-    int height = 30;
-    int bgcolor = 10;
-    int fgcolor = 0;
-    int fontSize = height;
-    M5EPD_Canvas canvas(&M5.EPD);
-    canvas.loadFont(FONT_FACE.c_str(), SD);
-    canvas.createRender(fontSize, 256);
-    canvas.createCanvas(width, height);
-    canvas.fillCanvas(bgcolor);
-    canvas.setTextSize(fontSize);
-    canvas.setTextColor(fgcolor, bgcolor);
-
-    canvas.drawString(seen_str, 0, 0);
-    canvas.drawString(valid_str, width / 2, 0);
-
-    canvas.pushCanvas(SCREEN_WIDTH - width - ROW_PADDING, ROW_HEIGHT + 25, UPDATE_MODE_A2);
-    canvas.deleteCanvas();
+    string counts = to_string(seen_devices) + "/" + to_string(active_sensors.size());
+    if (counts == lastCounts)
+        return;
+    lastCounts = counts;
+    drawDeviceCounts(seen_devices, active_sensors.size());
 }
 
-void loop()
+void logRenderStats(Print& out)
 {
-    M5.RTC.getTime(&RTCtime);
-    showDateTime();
+    const render_stats_t* stats;
+    size_t widgets = renderStats(&stats);
+    for (size_t i = 0; i < widgets; ++i) {
+        out.printf("render %-12s %6u calls  %8u us avg  %8u us max  %8u kpx\n", stats[i].widget,
+            (unsigned)stats[i].calls, (unsigned)(stats[i].calls ? stats[i].total_us / stats[i].calls : 0),
+            (unsigned)stats[i].max_us, (unsigned)(stats[i].pixels_pushed / 1000));
+    }
+    const uint32_t* latency;
+    size_t buckets = advertLatency(&latency);
+    for (size_t i = 0; i < buckets; ++i) {
+        if (latency[i] == 0)
+            continue;
+        if (i == buckets - 1)
+            out.printf("latency >= %6lu ms  %6u\n", 1ul << (i - 1), (unsigned)latency[i]);
+        else
+            out.printf("latency <  %6lu ms  %6u\n", 1ul << i, (unsigned)latency[i]);
+    }
+}
 
-    M5.RTC.getDate(&RTCDate);
-    showBattery();
+void logSensorStats(Print& out)
+{
+    for (const auto& sensor : active_sensors) {
+        auto it = sensor_stats.find(sensor.mac_addr.to_u64());
+        if (it == sensor_stats.end())
+            continue;
+        const SensorStats& stats = it->second;
+        out.printf("sensor %s  n=%u  temp %.2f/%.2f/%.2f sd %.2f  loss %.1f%%  rssi %.1f  interval %.0f ms  jitter %.0f ms\n",
+            sensor.mac_addr.to_str().c_str(), (unsigned)stats.samples(), stats.temp_min(), stats.temp_mean(),
+            stats.temp_max(), stats.temp_stddev(), stats.loss_rate() * 100.0f, stats.rssi(), stats.interval_ms(),
+            stats.jitter_ms());
+    }
+}
 
-    showTemperature();
+static unsigned long time_until(unsigned long now, unsigned long last, unsigned long interval)
+{
+    unsigned long elapsed = now - last;
+    return elapsed >= interval ? 0 : interval - elapsed;
+}
 
-    showWiFi();
+unsigned long last_frame = 0;
+unsigned long last_checkpoint = 0;
+bool checkpointed = false;
+unsigned long last_diagnostics = 0;
+int last_minute = -1;
 
-    showDeviceCounts();
+// How long the loop may sleep before something on screen or in the registry
+// is due to change without an event: the clock ticking over, a local sensor
+// sample, a reading going stale or timing out, or periodic housekeeping.
+unsigned long nextWake(unsigned long now)
+{
+    unsigned long wake = local_sensors.next_due(now);
+    struct tm local;
+    if (local_sensors.local_time(&local))
+        wake = min(wake, (unsigned long)(60 - local.tm_sec) * 1000);
+    wake = checkpointed ? min(wake, time_until(now, last_checkpoint, CHECKPOINT_INTERVAL)) : 0;
+    wake = min(wake, peerSyncNextDue(now));
+    if (RENDER_DIAGNOSTICS || RENDER_SNAPSHOTS)
+        wake = min(wake, time_until(now, last_diagnostics, DIAGNOSTICS_INTERVAL));
+    for (const auto& sensor : active_sensors) {
+        unsigned long age = now - sensor.timestamp;
+        if (age <= STALE_AFTER)
+            wake = min(wake, STALE_AFTER - age + 1);
+        else if (age <= SENSOR_TIMEOUT)
+            wake = min(wake, SENSOR_TIMEOUT - age + 1);
+    }
+    return wake;
+}
 
-    if (pBLEScan->isScanning() == false) {
-        pBLEScan->start(REFRESH_INTERVAL, nullptr, false);
+void loop()
+{
+    EventBits_t events = waitForEvents(nextWake(millis()));
+
+    if (events & (EVENT_ADVERT | EVENT_PEER)) {
+        // Let the rest of a burst arrive so it lands in one frame, and keep
+        // frames at least REFRESH_INTERVAL apart.
+        unsigned long hold = max(COALESCE_WINDOW, time_until(millis(), last_frame, REFRESH_INTERVAL));
+        delay(hold);
+        events |= takeEvents();
+    }
+    if (events & EVENT_WIFI) {
+        wifi_state_changed();
+    }
+    if (events & EVENT_TIME) {
+        setupRTCTime();
+    }
+    if ((events & EVENT_SCAN_DONE) || pBLEScan->isScanning() == false) {
+        pBLEScan->start(SCAN_DURATION, scanEnded, false);
     }
 
-    // time out old sensors
     unsigned long now = millis();
-    for (auto it = active_sensors.begin(); it != active_sensors.end(); it++) {
+    local_sensors.update(now);
+    updatePeerSync(now);
+
+    struct tm local;
+    if (local_sensors.local_time(&local) && local.tm_min != last_minute) {
+        // "seen" counts adverts heard in the current minute.
+        seen_devices = 0;
+        last_minute = local.tm_min;
+    }
+
+    showDateTime();
+    showBattery();
+    showTemperature();
+    showWiFi();
+
+    // time out old sensors
+    for (auto it = active_sensors.begin(); it != active_sensors.end();) {
         if (now - it->timestamp > SENSOR_TIMEOUT) {
-            active_sensors.erase(it);
+            sensor_stats.erase(it->mac_addr.to_u64());
+            it = active_sensors.erase(it);
+        } else {
+            ++it;
         }
     }
 
     // process new sensors
-    unsigned idx = 0;
-    for (const auto& new_sensor : new_sensors) {
+    vector<prst_sensor_data_t> received;
+    xSemaphoreTake(new_sensors_lock, portMAX_DELAY);
+    received.swap(new_sensors);
+    xSemaphoreGive(new_sensors_lock);
+    for (const auto& new_sensor : received) {
+        sensor_stats[new_sensor.mac_addr.to_u64()].add(new_sensor);
+        peerSyncLocalReading(new_sensor);
         bool known_sensor = false;
         for (auto& old_sensor : active_sensors) {
             if (old_sensor.mac_addr == new_sensor.mac_addr) {
@@ -343,17 +579,41 @@ void loop()
         }
     }
 
+    // readings relayed by other dashboards; these may be older than what we
+    // heard ourselves, and don't count towards link statistics. The AsyncUDP
+    // task stamps them, possibly after `now`, so the age is signed.
+    vector<prst_sensor_data_t> relayed;
+    takePeerReadings(relayed);
+    for (const auto& peer_sensor : relayed) {
+        if ((long)(now - peer_sensor.timestamp) > (long)SENSOR_TIMEOUT)
+            continue;
+        mergePeerReading(active_sensors, peer_sensor);
+    }
+
     // draw active sensor info to screen
-    idx = 0;
-    for (const auto& sensor : active_sensors) {
-        const size_t line_len = 64;
-        char line[line_len];
-        sensor.to_str(line, line_len);
-        drawRow(line, (idx + 2) * (ROW_HEIGHT + ROW_PADDING), 30);
-        ++idx;
+    showDeviceCounts();
+    drawSensorRows();
+    last_frame = millis();
+    for (const auto& sensor : received) {
+        recordAdvertLatency(last_frame - sensor.timestamp);
     }
 
-    new_sensors.clear();
-    seen_devices = 0;
-    delay(REFRESH_INTERVAL);
+    // The first frame completes the dashboard, so checkpoint it right away to
+    // allow quiet boots again.
+    if (!checkpointed || now - last_checkpoint > CHECKPOINT_INTERVAL) {
+        // Not `now`: readings merged since then were stamped after it.
+        checkpointState(active_sensors, drawn_rows, millis());
+        last_checkpoint = now;
+        checkpointed = true;
+    }
+
+    if ((RENDER_DIAGNOSTICS || RENDER_SNAPSHOTS) && now - last_diagnostics > DIAGNOSTICS_INTERVAL) {
+        if (RENDER_SNAPSHOTS)
+            writeRenderSnapshot("/snapshot.pgm");
+        if (RENDER_DIAGNOSTICS) {
+            logRenderStats(Serial);
+            logSensorStats(Serial);
+        }
+        last_diagnostics = now;
+    }
 }
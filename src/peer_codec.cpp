@@ -0,0 +1,125 @@
+#include "peer_codec.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "sensor_aliases.h"
+
+static const uint8_t SYNC_MAGIC[4] = { 'B', 'P', 'S', 'Y' };
+static const uint8_t SYNC_VERSION = 1;
+
+static const uint8_t FLAG_LIGHT = 0x01;
+static const uint8_t FLAG_SOIL = 0x02;
+
+static void put16(uint8_t* p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t v)
+{
+    put16(p, v);
+    put16(p + 2, v >> 16);
+}
+
+static uint16_t get16(const uint8_t* p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t get32(const uint8_t* p)
+{
+    return get16(p) | (uint32_t)get16(p + 2) << 16;
+}
+
+// Readings travel with their age rather than a timestamp, so peers don't
+// need synchronised clocks.
+static void encode_record(uint8_t* p, const prst_sensor_data_t& reading, unsigned long now)
+{
+    memcpy(p, reading.mac_addr.bytes, 6);
+    p[6] = reading.protocol;
+    p[7] = reading.protocol_version;
+    p[8] = (reading.has_light_sensor ? FLAG_LIGHT : 0) | (reading.has_soil_sensor ? FLAG_SOIL : 0);
+    p[9] = reading.run_counter;
+    put16(p + 10, reading.batt_mv);
+    put16(p + 12, (uint16_t)(int16_t)lroundf(reading.temp_c * 100.0f));
+    put16(p + 14, reading.humi);
+    put16(p + 16, reading.soil_moisture);
+    put16(p + 18, reading.light);
+    p[20] = (uint8_t)reading.rssi;
+    p[21] = 0;
+    put32(p + 22, now - reading.timestamp);
+}
+
+static prst_sensor_data_t decode_record(const uint8_t* p, unsigned long now)
+{
+    prst_sensor_data_t reading;
+    memcpy(reading.mac_addr.bytes, p, 6);
+    reading.protocol = (sensor_protocol_t)p[6];
+    reading.protocol_version = p[7];
+    reading.has_light_sensor = p[8] & FLAG_LIGHT;
+    reading.has_soil_sensor = p[8] & FLAG_SOIL;
+    reading.run_counter = p[9];
+    reading.batt_mv = get16(p + 10);
+    reading.temp_c = (int16_t)get16(p + 12) / 100.0f;
+    reading.humi = get16(p + 14);
+    reading.soil_moisture = get16(p + 16);
+    reading.light = get16(p + 18);
+    reading.rssi = (int8_t)p[20];
+    reading.alias_id = sensor_aliases.find(reading.mac_addr.to_u64());
+    reading.timestamp = now - get32(p + 22);
+    return reading;
+}
+
+size_t encodeSyncPacket(uint8_t* packet, const std::vector<prst_sensor_data_t>& readings, unsigned long now)
+{
+    size_t count = readings.size() < SYNC_MAX_RECORDS ? readings.size() : SYNC_MAX_RECORDS;
+    memcpy(packet, SYNC_MAGIC, 4);
+    packet[4] = SYNC_VERSION;
+    packet[5] = count;
+    for (size_t i = 0; i < count; ++i) {
+        encode_record(packet + SYNC_HEADER_LEN + i * SYNC_RECORD_LEN, readings[i], now);
+    }
+    return SYNC_HEADER_LEN + count * SYNC_RECORD_LEN;
+}
+
+bool decodeSyncPacket(const uint8_t* packet, size_t len, unsigned long now, std::vector<prst_sensor_data_t>& out)
+{
+    if (len < SYNC_HEADER_LEN || memcmp(packet, SYNC_MAGIC, 4) != 0 || packet[4] != SYNC_VERSION)
+        return false;
+    size_t count = packet[5];
+    if (len < SYNC_HEADER_LEN + count * SYNC_RECORD_LEN)
+        return false;
+    for (size_t i = 0; i < count; ++i) {
+        out.push_back(decode_record(packet + SYNC_HEADER_LEN + i * SYNC_RECORD_LEN, now));
+    }
+    return true;
+}
+
+bool newerReading(const prst_sensor_data_t& candidate, const prst_sensor_data_t& current)
+{
+    long age_difference = (long)(candidate.timestamp - current.timestamp);
+    if (age_difference > (long)SAME_READING_MS || age_difference < -(long)SAME_READING_MS)
+        return age_difference > 0;
+
+    // Close in time: the same counter is the same advert, otherwise the counter
+    // that is ahead by less than half its range is the newer reading.
+    uint16_t modulus = run_counter_modulus(candidate.protocol);
+    uint16_t ahead = (candidate.run_counter - current.run_counter + modulus) % modulus;
+    return ahead != 0 && ahead < modulus / 2;
+}
+
+bool mergePeerReading(std::vector<prst_sensor_data_t>& sensors, const prst_sensor_data_t& reading)
+{
+    for (auto& sensor : sensors) {
+        if (sensor.mac_addr == reading.mac_addr) {
+            if (!newerReading(reading, sensor))
+                return false;
+            sensor = reading;
+            return true;
+        }
+    }
+    sensors.push_back(reading);
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef _PEER_CODEC_H_
+#define _PEER_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "prst_data.h"
+
+// Wire format and merge rules for peer_sync.h, kept free of the network stack
+// so the native tests can run several dashboards against each other.
+//
+// A packet is a 6 byte header, "BPSY", a version and a record count, followed
+// by SYNC_RECORD_LEN bytes per reading, all little-endian.
+
+static const size_t SYNC_HEADER_LEN = 6;
+static const size_t SYNC_RECORD_LEN = 26;
+static const size_t SYNC_MAX_RECORDS = 48; // keeps a packet under one MTU
+static const size_t SYNC_PACKET_MAX = SYNC_HEADER_LEN + SYNC_MAX_RECORDS * SYNC_RECORD_LEN;
+
+// Two dashboards stamp the same advert at different times: each hears it on
+// its own scan cycle, maybe only on a later repeat, and the relayed age is
+// only as exact as the sender's loop.
+static const unsigned long SAME_READING_MS = 5000;
+
+// Write the first SYNC_MAX_RECORDS of `readings` as a packet of at most
+// SYNC_PACKET_MAX bytes. Returns its length.
+size_t encodeSyncPacket(uint8_t* packet, const std::vector<prst_sensor_data_t>& readings, unsigned long now);
+
+// Append the readings in a packet to `out`. Returns false, adding nothing, if
+// it is not a valid packet.
+bool decodeSyncPacket(const uint8_t* packet, size_t len, unsigned long now, std::vector<prst_sensor_data_t>& out);
+
+// True if `candidate` should replace `current`: last writer wins by reading
+// time. Readings less than SAME_READING_MS apart are ordered by run_counter
+// instead, so the same advert stamped by two dashboards is not taken twice.
+bool newerReading(const prst_sensor_data_t& candidate, const prst_sensor_data_t& current);
+
+// Add a relayed reading to `sensors`, or replace the one for its MAC if the
+// relayed reading is newer. Returns true if `sensors` changed.
+bool mergePeerReading(std::vector<prst_sensor_data_t>& sensors, const prst_sensor_data_t& reading);
+
+#endif // _PEER_CODEC_H_
@@ -0,0 +1,182 @@
+#include "peer_sync.h"
+
+#include <AsyncUDP.h>
+#include <ESPmDNS.h>
+#include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <climits>
+#include <map>
+
+#include "events.h"
+#include "peer_codec.h"
+
+extern unsigned SYNC_PORT;
+extern unsigned long SYNC_INTERVAL;
+extern bool WIFI_CONNECTED;
+
+static const size_t MAX_PEERS = 8;
+static const unsigned long DISCOVERY_INTERVAL = 5 * 60 * 1000;
+// Peers that send nothing themselves still answer every mDNS query, so one
+// missed for two discovery rounds has gone away.
+static const unsigned long PEER_TIMEOUT = 2 * DISCOVERY_INTERVAL + 60 * 1000;
+
+struct peer_t {
+    IPAddress address;
+    unsigned long last_heard;
+};
+
+static AsyncUDP udp;
+static bool listening = false;
+// Learned from mDNS by the loop task and from incoming packets by the AsyncUDP
+// task, so guarded by peers_lock.
+static std::vector<peer_t> peers;
+static SemaphoreHandle_t peers_lock = nullptr;
+
+// Local readings not yet sent, newest per MAC. Only touched by the loop task.
+static std::map<uint64_t, prst_sensor_data_t> pending;
+static unsigned long last_send = 0;
+static unsigned long last_discovery = 0;
+static bool discovered = false;
+
+// Readings from peers, filled by the AsyncUDP task.
+static std::vector<prst_sensor_data_t> received;
+static SemaphoreHandle_t received_lock = nullptr;
+
+static void add_peer(const IPAddress& address, unsigned long now)
+{
+    if (address == WiFi.localIP() || address == IPAddress((uint32_t)0))
+        return;
+    xSemaphoreTake(peers_lock, portMAX_DELAY);
+    bool known = false;
+    for (auto& peer : peers) {
+        if (peer.address == address) {
+            peer.last_heard = now;
+            known = true;
+            break;
+        }
+    }
+    if (!known && peers.size() < MAX_PEERS)
+        peers.push_back({ address, now });
+    xSemaphoreGive(peers_lock);
+}
+
+static void prune_peers(unsigned long now)
+{
+    xSemaphoreTake(peers_lock, portMAX_DELAY);
+    for (auto it = peers.begin(); it != peers.end();) {
+        // Signed, as the AsyncUDP task may have stamped a packet after `now`.
+        if ((long)(now - it->last_heard) > (long)PEER_TIMEOUT)
+            it = peers.erase(it);
+        else
+            ++it;
+    }
+    xSemaphoreGive(peers_lock);
+}
+
+static void handle_packet(AsyncUDPPacket& packet)
+{
+    unsigned long now = millis();
+    xSemaphoreTake(received_lock, portMAX_DELAY);
+    bool valid = decodeSyncPacket(packet.data(), packet.length(), now, received);
+    xSemaphoreGive(received_lock);
+    if (!valid)
+        return;
+    // Peers that started after our last mDNS query are learned from their packets.
+    add_peer(packet.remoteIP(), now);
+    postEvent(EVENT_PEER);
+}
+
+static void discover_peers(unsigned long now)
+{
+    int found = MDNS.queryService("bprst", "udp");
+    for (int i = 0; i < found; ++i) {
+        add_peer(MDNS.IP(i), now);
+    }
+}
+
+void beginPeerSync()
+{
+    if (SYNC_PORT == 0)
+        return;
+    if (received_lock == nullptr)
+        received_lock = xSemaphoreCreateMutex();
+    if (peers_lock == nullptr)
+        peers_lock = xSemaphoreCreateMutex();
+    if (!listening && udp.listen(SYNC_PORT)) {
+        udp.onPacket(handle_packet);
+        listening = true;
+    }
+    MDNS.addService("bprst", "udp", SYNC_PORT);
+    discovered = false;
+}
+
+void peerSyncLocalReading(const prst_sensor_data_t& reading)
+{
+    if (listening)
+        pending[reading.mac_addr.to_u64()] = reading;
+}
+
+void takePeerReadings(std::vector<prst_sensor_data_t>& out)
+{
+    if (received_lock == nullptr)
+        return;
+    xSemaphoreTake(received_lock, portMAX_DELAY);
+    out.insert(out.end(), received.begin(), received.end());
+    received.clear();
+    xSemaphoreGive(received_lock);
+}
+
+void updatePeerSync(unsigned long now)
+{
+    if (!listening || !WIFI_CONNECTED)
+        return;
+
+    if (!discovered || now - last_discovery >= DISCOVERY_INTERVAL) {
+        // Blocks for the mDNS query timeout, so this runs rarely.
+        discover_peers(now);
+        prune_peers(now);
+        discovered = true;
+        last_discovery = now;
+    }
+
+    if (pending.empty() || now - last_send < SYNC_INTERVAL)
+        return;
+    last_send = now;
+    xSemaphoreTake(peers_lock, portMAX_DELAY);
+    std::vector<peer_t> targets = peers;
+    xSemaphoreGive(peers_lock);
+    if (targets.empty()) {
+        pending.clear();
+        return;
+    }
+
+    std::vector<prst_sensor_data_t> batch;
+    for (auto it = pending.begin(); it != pending.end() && batch.size() < SYNC_MAX_RECORDS;) {
+        batch.push_back(it->second);
+        it = pending.erase(it);
+    }
+    uint8_t packet[SYNC_PACKET_MAX];
+    size_t len = encodeSyncPacket(packet, batch, now);
+    for (const auto& peer : targets) {
+        udp.writeTo(packet, len, peer.address, SYNC_PORT);
+    }
+}
+
+unsigned long peerSyncNextDue(unsigned long now)
+{
+    if (!listening || !WIFI_CONNECTED)
+        return ULONG_MAX;
+    unsigned long due = ULONG_MAX;
+    if (discovered) {
+        unsigned long elapsed = now - last_discovery;
+        due = elapsed >= DISCOVERY_INTERVAL ? 0 : DISCOVERY_INTERVAL - elapsed;
+    } else {
+        due = 0;
+    }
+    if (!pending.empty()) {
+        unsigned long elapsed = now - last_send;
+        due = min(due, elapsed >= SYNC_INTERVAL ? 0 : SYNC_INTERVAL - elapsed);
+    }
+    return due;
+}
@@ -0,0 +1,31 @@
+#ifndef _PEER_SYNC_H_
+#define _PEER_SYNC_H_
+
+#include <vector>
+
+#include "prst_data.h"
+
+// Shares sensor readings between dashboards on the same LAN, so every panel
+// shows the sensors heard by any of them. Peers advertise a "_bprst._udp"
+// service over mDNS and exchange batched binary updates of the readings they
+// received over BLE themselves; relayed readings are never forwarded again.
+// Peers are also learned from the packets they send, and dropped once neither
+// a packet nor an mDNS answer has been seen from them for a while. The packet
+// format and merge rules are in peer_codec.h.
+
+// Start listening and advertise the service. Call after mDNS is up.
+void beginPeerSync();
+
+// Queue a reading heard over BLE for the next batch.
+void peerSyncLocalReading(const prst_sensor_data_t& reading);
+
+// Move readings received from peers into `out`.
+void takePeerReadings(std::vector<prst_sensor_data_t>& out);
+
+// Send the pending batch and refresh the peer list when they are due.
+void updatePeerSync(unsigned long now);
+
+// Milliseconds from now until updatePeerSync() next has work to do.
+unsigned long peerSyncNextDue(unsigned long now);
+
+#endif // _PEER_SYNC_H_
@@ -7,6 +7,7 @@
 #include <string>
 
 #include "battery_util.h"
+#include "sensor_aliases.h"
 
 struct mac_addr_t {
     uint8_t bytes[6];
@@ -17,6 +18,15 @@ struct mac_addr_t {
         snprintf(mac_str, 18, "%02x-%02x-%02x-%02x-%02x-%02x", bytes[0], bytes[1], bytes[2], bytes[3], bytes[4], bytes[5]);
         return std::string(mac_str);
     };
+
+    uint64_t to_u64() const
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < 6; ++i) {
+            value = (value << 8) | bytes[i];
+        }
+        return value;
+    };
 };
 inline bool operator==(const mac_addr_t& lhs, const mac_addr_t& rhs)
 {
@@ -32,6 +42,29 @@ inline bool operator!=(const mac_addr_t& lhs, const mac_addr_t& rhs)
     return !(lhs == rhs);
 }
 
+// Advertising protocols understood by advert_decoders.h.
+enum sensor_protocol_t : uint8_t {
+    PROTOCOL_BPARASITE_V1,
+    PROTOCOL_BPARASITE_V2,
+    PROTOCOL_BTHOME_V2,
+    PROTOCOL_ATC,
+};
+
+// Run counters wrap at this value; b-parasite only sends four bits.
+inline uint16_t run_counter_modulus(sensor_protocol_t protocol)
+{
+    switch (protocol) {
+    case PROTOCOL_BPARASITE_V1:
+    case PROTOCOL_BPARASITE_V2:
+        return 16;
+    default:
+        return 256;
+    }
+}
+
+// Common measurement record for every supported protocol. Values are stored in
+// the b-parasite v2 units: humidity and soil moisture are scaled so that
+// 0..65535 spans 0..100%.
 struct prst_sensor_data_t {
     uint16_t batt_mv;
     float temp_c;
@@ -41,11 +74,14 @@ struct prst_sensor_data_t {
     uint8_t run_counter;
     mac_addr_t mac_addr;
     bool has_light_sensor;
+    bool has_soil_sensor;
+    sensor_protocol_t protocol;
     uint8_t protocol_version;
-    std::string alias;
+    uint16_t alias_id;
+    int8_t rssi;
     unsigned long timestamp;
 
-    const uint8_t supported_protocol_version = 2;
+    static const uint8_t supported_protocol_version = 2;
 
 public:
     prst_sensor_data_t()
@@ -57,8 +93,11 @@ public:
         , run_counter(0)
         , mac_addr({ 0, 0, 0, 0, 0, 0 })
         , has_light_sensor(false)
+        , has_soil_sensor(false)
+        , protocol(PROTOCOL_BPARASITE_V2)
         , protocol_version(supported_protocol_version)
-        , alias("")
+        , alias_id(SensorAliasTable::NO_ALIAS)
+        , rssi(0)
         , timestamp(millis())
     {
     }
@@ -71,8 +110,11 @@ public:
         , run_counter(other.run_counter)
         , mac_addr(other.mac_addr)
         , has_light_sensor(other.has_light_sensor)
+        , has_soil_sensor(other.has_soil_sensor)
+        , protocol(other.protocol)
         , protocol_version(other.protocol_version)
-        , alias(other.alias)
+        , alias_id(other.alias_id)
+        , rssi(other.rssi)
         , timestamp(other.timestamp)
     {
     }
@@ -85,12 +127,15 @@ public:
         , run_counter(other.run_counter)
         , mac_addr(other.mac_addr)
         , has_light_sensor(other.has_light_sensor)
+        , has_soil_sensor(other.has_soil_sensor)
+        , protocol(other.protocol)
         , protocol_version(other.protocol_version)
-        , alias(other.alias)
+        , alias_id(other.alias_id)
+        , rssi(other.rssi)
         , timestamp(other.timestamp)
     {
         other.timestamp = 0;
-        other.alias = "";
+        other.alias_id = SensorAliasTable::NO_ALIAS;
         other.mac_addr = { 0, 0, 0, 0, 0, 0 };
     }
     prst_sensor_data_t& operator=(const prst_sensor_data_t& other)
@@ -104,8 +149,11 @@ public:
             run_counter = other.run_counter;
             mac_addr = other.mac_addr;
             has_light_sensor = other.has_light_sensor;
+            has_soil_sensor = other.has_soil_sensor;
+            protocol = other.protocol;
             protocol_version = other.protocol_version;
-            alias = other.alias;
+            alias_id = other.alias_id;
+            rssi = other.rssi;
             timestamp = other.timestamp;
         }
         return *this;
@@ -121,8 +169,11 @@ public:
             run_counter = other.run_counter;
             mac_addr = other.mac_addr;
             has_light_sensor = other.has_light_sensor;
+            has_soil_sensor = other.has_soil_sensor;
+            protocol = other.protocol;
             protocol_version = other.protocol_version;
-            alias = other.alias;
+            alias_id = other.alias_id;
+            rssi = other.rssi;
             timestamp = other.timestamp;
         }
         return *this;
@@ -153,6 +204,8 @@ public:
         // Bit 0 of byte 0 specifies whether or not ambient light data exists in the
         // payload.
         sensor.has_light_sensor = service_data[0] & 0x01;
+        sensor.has_soil_sensor = true;
+        sensor.protocol = PROTOCOL_BPARASITE_V2;
 
         // 4 bits for a small wrap-around counter for deduplicating messages on the
         // receiver.
@@ -161,9 +214,7 @@ public:
         sensor.batt_mv = service_data[2] << 8;
         sensor.batt_mv |= service_data[3];
 
-        uint16_t temp_centicelsius = 0;
-        temp_centicelsius = service_data[4] << 8;
-        temp_centicelsius |= service_data[5];
+        int16_t temp_centicelsius = (int16_t)(service_data[4] << 8 | service_data[5]);
         sensor.temp_c = temp_centicelsius / 100.0f;
 
         sensor.humi = service_data[6] << 8;
@@ -189,20 +240,21 @@ public:
 
     void to_str(char* str, size_t maxlen) const
     {
-        std::string name = alias.empty() ? mac_addr.to_str() : alias;
+        const char* alias = sensor_aliases.name(alias_id);
+        std::string name = alias ? alias : mac_addr.to_str();
         std::string batt_icon = battery_icon(battery_pct()).c_str();
         float soil_pct = soil_moisture / 655.35;
         float temp_f = (temp_c * 1.8f) + 32.0;
-        float hum_pct = humi / 1000.0;
+        float hum_pct = humi / 655.35;
         float lux = light * 1.0f;
 
-        if (has_light_sensor) {
-            snprintf(str, maxlen, "%1s %-18s  —  %2.0f%%, %3.1f°F, %2.1f%%RH, %.0flux", batt_icon.c_str(), name.c_str(),
-                soil_pct, temp_f, hum_pct, lux);
-        } else {
-            snprintf(str, maxlen, "%1s %-18s  —  %2.0f%%, %3.1f°F, %2.1f%%RH", batt_icon.c_str(), name.c_str(), soil_pct,
-                temp_f, hum_pct);
-        }
+        size_t len = snprintf(str, maxlen, "%1s %-18s  — ", batt_icon.c_str(), name.c_str());
+        if (has_soil_sensor && len < maxlen)
+            len += snprintf(str + len, maxlen - len, " %2.0f%%,", soil_pct);
+        if (len < maxlen)
+            len += snprintf(str + len, maxlen - len, " %3.1f°F, %2.1f%%RH", temp_f, hum_pct);
+        if (has_light_sensor && len < maxlen)
+            snprintf(str + len, maxlen - len, ", %.0flux", lux);
     };
 };
 
@@ -0,0 +1,127 @@
+#include "render.h"
+
+#include "bitmap_font.h"
+#include <M5EPD.h>
+
+#include <cstring>
+#include <string>
+
+// Device backend: each block is drawn on an M5EPD canvas and pushed to the panel.
+
+extern std::string FONT_FACE;
+
+// Two pixels per byte, left pixel in the high nibble, same as the canvas.
+static uint8_t* snapshot = nullptr;
+
+static m5epd_update_mode_t panel_mode(render_mode_t mode)
+{
+    return mode == RENDER_MODE_A2 ? UPDATE_MODE_A2 : UPDATE_MODE_GLR16;
+}
+
+static void copy_to_snapshot(M5EPD_Canvas& canvas, const render_block_t& block)
+{
+    for (int y = 0; y < block.height; ++y) {
+        int sy = block.y + y;
+        if (sy < 0 || sy >= SCREEN_HEIGHT)
+            continue;
+        for (int x = 0; x < block.width; ++x) {
+            int sx = block.x + x;
+            if (sx < 0 || sx >= SCREEN_WIDTH)
+                continue;
+            uint8_t pixel = canvas.readPixel(x, y) & 0x0f;
+            uint8_t& byte = snapshot[(sy * SCREEN_WIDTH + sx) / 2];
+            if (sx & 1)
+                byte = (byte & 0xf0) | pixel;
+            else
+                byte = (byte & 0x0f) | (pixel << 4);
+        }
+    }
+}
+
+static void clear_column(M5EPD_Canvas& canvas, const render_block_t& block, const render_text_t& text)
+{
+    if (text.clear_width > 0)
+        canvas.fillRect(text.x, 0, text.clear_width, block.height, block.bgcolor);
+}
+
+void renderBlock(const render_block_t& block)
+{
+    uint32_t start = micros();
+
+    // Use the pre-rasterized atlas when it has every glyph the block needs,
+    // otherwise fall back to rendering the TTF from the SD card.
+    bool use_atlas = true;
+    for (size_t i = 0; i < block.text_count && use_atlas; ++i) {
+        use_atlas = font_atlas.covers(block.texts[i].text, block.font_size);
+    }
+
+    M5EPD_Canvas canvas(&M5.EPD);
+    if (!use_atlas) {
+        canvas.loadFont(FONT_FACE.c_str(), SD);
+        canvas.createRender(block.font_size, 256);
+    }
+    canvas.createCanvas(block.width, block.height);
+    canvas.fillCanvas(block.bgcolor);
+    if (use_atlas) {
+        for (size_t i = 0; i < block.text_count; ++i) {
+            clear_column(canvas, block, block.texts[i]);
+            font_atlas.draw(canvas, block.texts[i].text, block.texts[i].x, block.texts[i].y, block.font_size,
+                block.fgcolor, block.bgcolor);
+        }
+    } else {
+        canvas.setTextSize(block.font_size);
+        canvas.setTextColor(block.fgcolor, block.bgcolor);
+        for (size_t i = 0; i < block.text_count; ++i) {
+            clear_column(canvas, block, block.texts[i]);
+            canvas.drawString(block.texts[i].text, block.texts[i].x, block.texts[i].y);
+        }
+    }
+    canvas.pushCanvas(block.x, block.y, panel_mode(block.mode));
+    // Stop the clock first; the snapshot copy is diagnostics overhead.
+    recordRenderStats(block.widget, micros() - start, block.width * block.height);
+
+    if (snapshot != nullptr)
+        copy_to_snapshot(canvas, block);
+    canvas.deleteCanvas();
+}
+
+bool enableRenderSnapshots()
+{
+    if (snapshot != nullptr)
+        return true;
+    size_t size = SCREEN_WIDTH * SCREEN_HEIGHT / 2;
+    snapshot = (uint8_t*)ps_malloc(size);
+    if (snapshot == nullptr)
+        return false;
+    // The panel starts out white.
+    memset(snapshot, 0, size);
+    return true;
+}
+
+const uint8_t* renderSnapshot()
+{
+    return snapshot;
+}
+
+bool writeRenderSnapshot(const char* path)
+{
+    if (snapshot == nullptr)
+        return false;
+    SDFile file = SD.open(path, FILE_WRITE);
+    if (!file)
+        return false;
+
+    file.printf("P5\n%d %d\n15\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+    uint8_t line[SCREEN_WIDTH];
+    for (int y = 0; y < SCREEN_HEIGHT; ++y) {
+        const uint8_t* row = snapshot + y * SCREEN_WIDTH / 2;
+        for (int x = 0; x < SCREEN_WIDTH; x += 2) {
+            // 15 is black on the panel and white in a PGM.
+            line[x] = 15 - (row[x / 2] >> 4);
+            line[x + 1] = 15 - (row[x / 2] & 0x0f);
+        }
+        file.write(line, SCREEN_WIDTH);
+    }
+    file.close();
+    return true;
+}
@@ -0,0 +1,78 @@
+#ifndef _RENDER_H_
+#define _RENDER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Widget drawing goes through renderBlock(). Nothing in this header depends on
+// the device: render.cpp implements it on the M5EPD panel and render_host.cpp
+// rasterizes into an in-memory framebuffer for the native tests.
+
+// Panel geometry in landscape orientation.
+const int SCREEN_WIDTH = 960;
+const int SCREEN_HEIGHT = 540;
+
+// How the panel refreshes a block; the device backend maps these onto the
+// M5EPD update modes of the same name.
+enum render_mode_t {
+    RENDER_MODE_A2, // fast, black and white only
+    RENDER_MODE_GLR16, // slower, all 16 grey levels
+};
+
+// A run of text drawn at (x, y) relative to its block. Texts are drawn in
+// order; a non-zero clear_width first fills that many pixels from x with the
+// background, cutting off earlier texts that run into this one.
+struct render_text_t {
+    const char* text;
+    int x;
+    int y;
+    int clear_width;
+};
+
+// One rectangular region of the panel, filled with bgcolor and overlaid with
+// text. Every widget on the dashboard is drawn as a single block.
+struct render_block_t {
+    const char* widget; // name used for render statistics
+    int x;
+    int y;
+    int width;
+    int height;
+    int font_size;
+    int fgcolor;
+    int bgcolor;
+    render_mode_t mode;
+    const render_text_t* texts;
+    size_t text_count;
+};
+
+// Rasterize a block and push it to the panel.
+void renderBlock(const render_block_t& block);
+
+// Per-widget counters, accumulated since boot.
+struct render_stats_t {
+    const char* widget;
+    uint32_t calls;
+    uint64_t total_us;
+    uint32_t max_us;
+    uint64_t pixels_pushed;
+};
+
+size_t renderStats(const render_stats_t** stats);
+
+// Called by the backends once a block is on the panel.
+void recordRenderStats(const char* widget, uint32_t elapsed_us, uint32_t pixels);
+
+// Time from an advert being decoded to its row being pushed to the panel,
+// kept as a histogram with power-of-two millisecond buckets. Bucket i counts
+// latencies below 2^i ms, the last one everything above.
+void recordAdvertLatency(unsigned long ms);
+size_t advertLatency(const uint32_t** buckets);
+
+// While enabled, every block is also copied into an in-memory 960x540 4bpp
+// framebuffer (two pixels per byte, left pixel in the high nibble, 0 = white)
+// that can be read back or written out as a PGM image.
+bool enableRenderSnapshots();
+const uint8_t* renderSnapshot();
+bool writeRenderSnapshot(const char* path);
+
+#endif // _RENDER_H_
@@ -0,0 +1,60 @@
+#include "render.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+// State shared by the device and host render backends.
+
+// TTF used when the glyph atlas does not cover a block, overridden from
+// config.txt at boot.
+std::string FONT_FACE = "/default.ttf";
+
+static const size_t MAX_WIDGETS = 16;
+static render_stats_t widget_stats[MAX_WIDGETS];
+static size_t widget_count = 0;
+
+static const size_t LATENCY_BUCKETS = 18; // up to 2^16 ms, then overflow
+static uint32_t latency_histogram[LATENCY_BUCKETS];
+
+void recordRenderStats(const char* widget, uint32_t elapsed_us, uint32_t pixels)
+{
+    render_stats_t* stats = nullptr;
+    for (size_t i = 0; i < widget_count; ++i) {
+        if (strcmp(widget_stats[i].widget, widget) == 0) {
+            stats = &widget_stats[i];
+            break;
+        }
+    }
+    if (stats == nullptr) {
+        if (widget_count == MAX_WIDGETS)
+            return;
+        stats = &widget_stats[widget_count++];
+        stats->widget = widget;
+    }
+    stats->calls += 1;
+    stats->total_us += elapsed_us;
+    stats->max_us = std::max(stats->max_us, elapsed_us);
+    stats->pixels_pushed += pixels;
+}
+
+size_t renderStats(const render_stats_t** stats)
+{
+    *stats = widget_stats;
+    return widget_count;
+}
+
+void recordAdvertLatency(unsigned long ms)
+{
+    size_t bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && ms >= (1ul << bucket)) {
+        ++bucket;
+    }
+    latency_histogram[bucket] += 1;
+}
+
+size_t advertLatency(const uint32_t** buckets)
+{
+    *buckets = latency_histogram;
+    return LATENCY_BUCKETS;
+}
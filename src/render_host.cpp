@@ -0,0 +1,153 @@
+#include "render.h"
+
+#include "utf8.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ft2build.h>
+#include <string>
+#include FT_FREETYPE_H
+
+// Host backend, used by the native tests. Blocks are rasterized with FreeType
+// from the same TTF into a 960x540 4bpp framebuffer, laid out the way the glyph
+// atlas draws on the device: the text position is the top of the line box and
+// coverage is quantized to the panel's 16 grey levels. FONT_FACE is a path on
+// the host filesystem here.
+
+extern std::string FONT_FACE;
+
+// Same layout as the device snapshot: two pixels per byte, left pixel in the
+// high nibble, 0 = white.
+static uint8_t framebuffer[SCREEN_WIDTH * SCREEN_HEIGHT / 2];
+
+static FT_Library library = nullptr;
+static FT_Face face = nullptr;
+static std::string face_path;
+
+static bool load_face()
+{
+    if (face != nullptr && face_path == FONT_FACE)
+        return true;
+    if (library == nullptr && FT_Init_FreeType(&library) != 0)
+        return false;
+    if (face != nullptr) {
+        FT_Done_Face(face);
+        face = nullptr;
+    }
+    if (FT_New_Face(library, FONT_FACE.c_str(), 0, &face) != 0) {
+        face = nullptr;
+        return false;
+    }
+    face_path = FONT_FACE;
+    return true;
+}
+
+static void set_pixel(int x, int y, int color)
+{
+    uint8_t& byte = framebuffer[(y * SCREEN_WIDTH + x) / 2];
+    if (x & 1)
+        byte = (byte & 0xf0) | (color & 0x0f);
+    else
+        byte = (byte & 0x0f) | (color & 0x0f) << 4;
+}
+
+// Blocks are clipped to themselves and to the panel, like a canvas pushed to it.
+static bool in_block(const render_block_t& block, int x, int y)
+{
+    return x >= block.x && x < block.x + block.width && y >= block.y && y < block.y + block.height && x >= 0
+        && x < SCREEN_WIDTH && y >= 0 && y < SCREEN_HEIGHT;
+}
+
+static void draw_text(const render_block_t& block, const render_text_t& text)
+{
+    for (int y = block.y; y < block.y + block.height; ++y) {
+        for (int x = block.x + text.x; x < block.x + text.x + text.clear_width; ++x) {
+            if (in_block(block, x, y))
+                set_pixel(x, y, block.bgcolor);
+        }
+    }
+
+    int baseline = block.y + text.y + (int)((face->size->metrics.ascender + 63) >> 6);
+    int pen_x = block.x + text.x;
+    FT_UInt prev = 0;
+    const char* p = text.text;
+    while (uint32_t cp = next_codepoint(p)) {
+        FT_UInt index = FT_Get_Char_Index(face, cp);
+        if (index == 0)
+            continue;
+        if (prev != 0 && FT_HAS_KERNING(face)) {
+            FT_Vector delta;
+            FT_Get_Kerning(face, prev, index, FT_KERNING_DEFAULT, &delta);
+            pen_x += (delta.x + 32) >> 6;
+        }
+        prev = index;
+        if (FT_Load_Glyph(face, index, FT_LOAD_RENDER | FT_LOAD_TARGET_NORMAL) != 0)
+            continue;
+
+        const FT_GlyphSlot slot = face->glyph;
+        const FT_Bitmap& bitmap = slot->bitmap;
+        int gx = pen_x + slot->bitmap_left;
+        int gy = baseline - slot->bitmap_top;
+        for (unsigned j = 0; j < bitmap.rows; ++j) {
+            const uint8_t* row = bitmap.buffer + j * bitmap.pitch;
+            for (unsigned i = 0; i < bitmap.width; ++i) {
+                int coverage = (row[i] * 15 + 127) / 255;
+                if (coverage == 0 || !in_block(block, gx + i, gy + j))
+                    continue;
+                set_pixel(gx + i, gy + j, block.bgcolor + (block.fgcolor - block.bgcolor) * coverage / 15);
+            }
+        }
+        pen_x += (slot->advance.x + 32) >> 6;
+    }
+}
+
+void renderBlock(const render_block_t& block)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int y = block.y; y < block.y + block.height; ++y) {
+        for (int x = block.x; x < block.x + block.width; ++x) {
+            if (in_block(block, x, y))
+                set_pixel(x, y, block.bgcolor);
+        }
+    }
+    if (load_face() && FT_Set_Pixel_Sizes(face, 0, block.font_size) == 0) {
+        for (size_t i = 0; i < block.text_count; ++i) {
+            draw_text(block, block.texts[i]);
+        }
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    recordRenderStats(block.widget, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(),
+        block.width * block.height);
+}
+
+bool enableRenderSnapshots()
+{
+    return true;
+}
+
+const uint8_t* renderSnapshot()
+{
+    return framebuffer;
+}
+
+bool writeRenderSnapshot(const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr)
+        return false;
+
+    fprintf(file, "P5\n%d %d\n15\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+    uint8_t line[SCREEN_WIDTH];
+    for (int y = 0; y < SCREEN_HEIGHT; ++y) {
+        const uint8_t* row = framebuffer + y * SCREEN_WIDTH / 2;
+        for (int x = 0; x < SCREEN_WIDTH; x += 2) {
+            // 15 is black on the panel and white in a PGM.
+            line[x] = 15 - (row[x / 2] >> 4);
+            line[x + 1] = 15 - (row[x / 2] & 0x0f);
+        }
+        fwrite(line, 1, SCREEN_WIDTH, file);
+    }
+    return fclose(file) == 0;
+}
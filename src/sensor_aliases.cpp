@@ -0,0 +1,101 @@
+#include "sensor_aliases.h"
+
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+SensorAliasTable sensor_aliases;
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c = std::tolower((unsigned char)c);
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+bool SensorAliasTable::parse_mac(const std::string& str, uint64_t& mac)
+{
+    // Accept "aa-bb-cc-dd-ee-ff" or "aa:bb:cc:dd:ee:ff".
+    if (str.size() != 17)
+        return false;
+    uint64_t value = 0;
+    for (size_t i = 0; i < 6; ++i) {
+        int hi = hex_digit(str[i * 3]);
+        int lo = hex_digit(str[i * 3 + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        if (i < 5 && str[i * 3 + 2] != '-' && str[i * 3 + 2] != ':')
+            return false;
+        value = (value << 8) | (uint64_t)(hi << 4 | lo);
+    }
+    mac = value;
+    return true;
+}
+
+void SensorAliasTable::build(const std::map<std::string, std::string>& names)
+{
+    std::vector<std::pair<uint64_t, const std::string*>> entries;
+    entries.reserve(names.size());
+    for (const auto& pair : names) {
+        uint64_t mac;
+        if (parse_mac(pair.first, mac))
+            entries.emplace_back(mac, &pair.second);
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+        [](const std::pair<uint64_t, const std::string*>& a, const std::pair<uint64_t, const std::string*>& b) {
+            return a.first < b.first;
+        });
+    // "aa-bb-.." and "AA:BB:.." parse to the same key; the sort is stable, so
+    // the one that comes first in the map wins.
+    entries.erase(std::unique(entries.begin(), entries.end(),
+                      [](const std::pair<uint64_t, const std::string*>& a,
+                          const std::pair<uint64_t, const std::string*>& b) { return a.first == b.first; }),
+        entries.end());
+    // Ids are 16 bits and NO_ALIAS is reserved.
+    if (entries.size() > NO_ALIAS)
+        entries.resize(NO_ALIAS);
+
+    count = entries.size();
+    size_t padded = 1;
+    while (padded < count)
+        padded <<= 1;
+
+    keys.assign(padded, UINT64_MAX);
+    offsets.assign(padded, 0);
+    pool.clear();
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = entries[i].first;
+        offsets[i] = pool.size();
+        pool.append(*entries[i].second);
+        pool.push_back('\0');
+    }
+    keys.shrink_to_fit();
+    offsets.shrink_to_fit();
+    pool.shrink_to_fit();
+}
+
+uint16_t SensorAliasTable::find(uint64_t mac) const
+{
+    if (count == 0)
+        return NO_ALIAS;
+
+    // Branch-free lower bound over the power-of-two padded key array; the
+    // padding keys are larger than any 48-bit MAC.
+    const uint64_t* base = keys.data();
+    for (size_t half = keys.size() / 2; half > 0; half /= 2)
+        base = (base[half] <= mac) ? base + half : base;
+
+    if (*base != mac)
+        return NO_ALIAS;
+    return (uint16_t)(base - keys.data());
+}
+
+const char* SensorAliasTable::name(uint16_t id) const
+{
+    if (id >= count)
+        return nullptr;
+    return pool.c_str() + offsets[id];
+}
@@ -0,0 +1,46 @@
+#ifndef _SENSOR_ALIASES_H_
+#define _SENSOR_ALIASES_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Maps 48-bit MAC addresses to the aliases configured in sensors.txt.
+//
+// The table is built once at boot. Keys are kept in a sorted array and all of
+// the alias strings are packed into a single pool, so a lookup is a fixed
+// number of compares with no allocations or string formatting.
+class SensorAliasTable {
+public:
+    static const uint16_t NO_ALIAS = 0xffff;
+
+    // Build the table from "aa-bb-cc-dd-ee-ff" => alias pairs. Entries whose key
+    // does not parse as a MAC address are skipped, as are any beyond the first
+    // NO_ALIAS entries.
+    void build(const std::map<std::string, std::string>& names);
+
+    // Returns the alias id for a MAC address, or NO_ALIAS.
+    uint16_t find(uint64_t mac) const;
+
+    // Returns the alias for an id returned by find(), or nullptr for NO_ALIAS.
+    const char* name(uint16_t id) const;
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    static bool parse_mac(const std::string& str, uint64_t& mac);
+
+private:
+    std::vector<uint64_t> keys; // sorted, padded to a power of two
+    std::vector<uint32_t> offsets; // into pool, parallel to keys
+    std::string pool; // NUL-separated aliases
+    size_t count = 0;
+};
+
+extern SensorAliasTable sensor_aliases;
+
+#endif // _SENSOR_ALIASES_H_
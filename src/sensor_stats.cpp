@@ -0,0 +1,114 @@
+#include "sensor_stats.h"
+
+#include <cmath>
+
+const size_t SensorStats::WINDOW_SAMPLES;
+const unsigned long SensorStats::WINDOW_MS;
+
+// Weight of a new RSSI or interval sample in the moving averages.
+static const float SMOOTHING = 0.125f;
+
+void SensorStats::remove_oldest()
+{
+    const sample_t& oldest = at(first_seq);
+    expected -= oldest.gap;
+    if (count == 1) {
+        mean = 0;
+        m2 = 0;
+    } else {
+        float x = oldest.temp_centi;
+        float old_mean = mean;
+        mean = (mean * count - x) / (count - 1);
+        m2 -= (x - old_mean) * (x - mean);
+        if (m2 < 0)
+            m2 = 0;
+    }
+    --count;
+    if (min_deque.len && min_deque.front() == first_seq)
+        min_deque.pop_front();
+    if (max_deque.len && max_deque.front() == first_seq)
+        max_deque.pop_front();
+    ++first_seq;
+}
+
+void SensorStats::expire(unsigned long now)
+{
+    while (count > 0 && now - at(first_seq).timestamp > WINDOW_MS) {
+        remove_oldest();
+    }
+}
+
+void SensorStats::add(const prst_sensor_data_t& reading)
+{
+    if (!have_rssi) {
+        rssi_avg = reading.rssi;
+        have_rssi = true;
+    } else {
+        rssi_avg += SMOOTHING * (reading.rssi - rssi_avg);
+    }
+
+    uint16_t modulus = run_counter_modulus(reading.protocol);
+    uint8_t gap = 1;
+    if (have_counter) {
+        gap = (reading.run_counter - last_counter + modulus) % modulus;
+        if (gap == 0)
+            return;
+
+        // Jitter is the smoothed deviation from the smoothed per-advert interval.
+        float interval = (float)(reading.timestamp - last_arrival) / gap;
+        if (interval_avg == 0)
+            interval_avg = interval;
+        jitter += SMOOTHING * (fabsf(interval - interval_avg) - jitter);
+        interval_avg += SMOOTHING * (interval - interval_avg);
+    }
+    have_counter = true;
+    last_counter = reading.run_counter;
+    last_arrival = reading.timestamp;
+
+    expire(reading.timestamp);
+    if (count == WINDOW_SAMPLES)
+        remove_oldest();
+
+    uint32_t seq = next_seq++;
+    sample_t& sample = ring[seq % WINDOW_SAMPLES];
+    sample.timestamp = reading.timestamp;
+    sample.temp_centi = (int16_t)lroundf(reading.temp_c * 100.0f);
+    sample.gap = gap;
+    expected += gap;
+
+    float x = sample.temp_centi;
+    ++count;
+    float delta = x - mean;
+    mean += delta / count;
+    m2 += delta * (x - mean);
+
+    while (min_deque.len && at(min_deque.back()).temp_centi >= sample.temp_centi) {
+        min_deque.pop_back();
+    }
+    min_deque.push_back(seq);
+    while (max_deque.len && at(max_deque.back()).temp_centi <= sample.temp_centi) {
+        max_deque.pop_back();
+    }
+    max_deque.push_back(seq);
+}
+
+float SensorStats::temp_min() const
+{
+    return min_deque.len ? at(min_deque.front()).temp_centi / 100.0f : 0;
+}
+
+float SensorStats::temp_max() const
+{
+    return max_deque.len ? at(max_deque.front()).temp_centi / 100.0f : 0;
+}
+
+float SensorStats::temp_stddev() const
+{
+    return count > 1 ? sqrtf(m2 / (count - 1)) / 100.0f : 0;
+}
+
+float SensorStats::loss_rate() const
+{
+    // The first sample's gap is always 1, so expected >= count.
+    return expected ? 1.0f - (float)count / expected : 0;
+}
@@ -0,0 +1,122 @@
+#ifndef _SENSOR_STATS_H_
+#define _SENSOR_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "prst_data.h"
+
+// Rolling statistics for one sensor. Every update is O(1) and the memory per
+// sensor is fixed, so the window is a sample count: the last WINDOW_SAMPLES
+// readings, dropping any older than WINDOW_MS. A sensor that advertises a new
+// reading every 10 s fills it in about 11 minutes; only sensors slower than
+// one reading a minute are limited by WINDOW_MS.
+//
+//  - temperature min/max come from monotonic deques over the window
+//  - temperature mean/variance use Welford's update, with removal of samples
+//    that leave the window
+//  - advert loss is derived from gaps in run_counter over the window
+//  - RSSI and inter-arrival jitter are exponentially smoothed
+class SensorStats {
+public:
+    static const size_t WINDOW_SAMPLES = 64;
+    static const unsigned long WINDOW_MS = 60 * 60 * 1000;
+
+    // Record an advert. Repeats of the last run_counter only update RSSI.
+    void add(const prst_sensor_data_t& reading);
+
+    size_t samples() const
+    {
+        return count;
+    }
+    float temp_min() const;
+    float temp_max() const;
+    float temp_mean() const
+    {
+        return mean / 100.0f;
+    }
+    float temp_stddev() const;
+
+    // Fraction of adverts missed in the window, 0..1.
+    float loss_rate() const;
+
+    float rssi() const
+    {
+        return rssi_avg;
+    }
+    float interval_ms() const
+    {
+        return interval_avg;
+    }
+    float jitter_ms() const
+    {
+        return jitter;
+    }
+
+private:
+    struct sample_t {
+        unsigned long timestamp;
+        int16_t temp_centi;
+        uint8_t gap; // adverts the counter advanced by, 1 if none were lost
+    };
+
+    // Ring of sequence numbers; slot = seq % WINDOW_SAMPLES.
+    struct deque_t {
+        uint32_t seq[WINDOW_SAMPLES];
+        size_t head = 0;
+        size_t len = 0;
+
+        uint32_t front() const
+        {
+            return seq[head];
+        }
+        uint32_t back() const
+        {
+            return seq[(head + len - 1) % WINDOW_SAMPLES];
+        }
+        void pop_front()
+        {
+            head = (head + 1) % WINDOW_SAMPLES;
+            --len;
+        }
+        void pop_back()
+        {
+            --len;
+        }
+        void push_back(uint32_t s)
+        {
+            seq[(head + len) % WINDOW_SAMPLES] = s;
+            ++len;
+        }
+    };
+
+    const sample_t& at(uint32_t seq) const
+    {
+        return ring[seq % WINDOW_SAMPLES];
+    }
+    void expire(unsigned long now);
+    void remove_oldest();
+
+    sample_t ring[WINDOW_SAMPLES];
+    uint32_t first_seq = 0; // oldest sample still in the window
+    uint32_t next_seq = 0;
+    size_t count = 0;
+
+    deque_t min_deque;
+    deque_t max_deque;
+
+    float mean = 0;
+    float m2 = 0;
+    uint32_t expected = 0;
+
+    bool have_counter = false;
+    uint8_t last_counter = 0;
+    unsigned long last_arrival = 0;
+
+    float rssi_avg = 0;
+    bool have_rssi = false;
+    float interval_avg = 0;
+    float jitter = 0;
+};
+
+#endif // _SENSOR_STATS_H_
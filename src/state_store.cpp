@@ -0,0 +1,254 @@
+#include "state_store.h"
+
+#include <M5EPD.h>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <esp_attr.h>
+
+extern int ROW_HEIGHT;
+extern int ROW_PADDING;
+
+static const uint32_t STATE_MAGIC = 0x50525354; // "PRST"
+static const uint16_t STATE_VERSION = 1;
+static const size_t MAX_PERSISTED_SENSORS = 48;
+static const char* STATE_PATH = "/state.bin";
+
+struct persisted_sensor_t {
+    uint8_t mac[6];
+    uint8_t protocol;
+    uint8_t protocol_version;
+    uint8_t flags;
+    uint8_t run_counter;
+    uint16_t batt_mv;
+    int16_t temp_centi;
+    uint16_t humi;
+    uint16_t soil_moisture;
+    uint16_t light;
+    uint32_t age_s; // age of the reading when the checkpoint was taken
+};
+
+static const uint8_t FLAG_LIGHT = 0x01;
+static const uint8_t FLAG_SOIL = 0x02;
+
+struct persisted_state_t {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t saved_at; // RTC seconds, 0 if the RTC was not set
+    uint8_t row_height;
+    uint8_t row_padding;
+    uint8_t drawn_rows;
+    uint8_t dashboard_drawn; // the panel showed this dashboard in full
+    persisted_sensor_t sensors[MAX_PERSISTED_SENSORS];
+    uint32_t checksum;
+};
+
+// Survives software resets and deep sleep, but not power loss.
+RTC_NOINIT_ATTR static persisted_state_t rtc_state;
+
+static persisted_state_t loaded;
+static bool have_loaded = false;
+static uint32_t sd_checksum = 0;
+
+static uint32_t state_checksum(const persisted_state_t& state)
+{
+    // FNV-1a over everything but the checksum itself.
+    const uint8_t* bytes = (const uint8_t*)&state;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(persisted_state_t, checksum); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Ages and saved_at change on every checkpoint, so the SD copy is only
+// rewritten when this checksum over the readings and panel state changes.
+static uint32_t readings_checksum(const persisted_state_t& state)
+{
+    persisted_state_t readings = state;
+    readings.saved_at = 0;
+    for (size_t i = 0; i < readings.count; ++i) {
+        readings.sensors[i].age_s = 0;
+    }
+    return state_checksum(readings);
+}
+
+static bool state_valid(const persisted_state_t& state)
+{
+    return state.magic == STATE_MAGIC && state.version == STATE_VERSION && state.count <= MAX_PERSISTED_SENSORS
+        && state.checksum == state_checksum(state);
+}
+
+// Seconds since 2000-01-01 according to the RTC, which keeps local time.
+// Used instead of the system clock because it is valid before NTP runs and
+// does not depend on the configured time zone.
+static uint32_t rtc_seconds()
+{
+    rtc_time_t rtc_time;
+    rtc_date_t rtc_date;
+    M5.RTC.getTime(&rtc_time);
+    M5.RTC.getDate(&rtc_date);
+    if (rtc_date.year < 2020)
+        return 0;
+
+    // Days from civil, see http://howardhinnant.github.io/date_algorithms.html
+    int y = rtc_date.year - (rtc_date.mon <= 2);
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (rtc_date.mon + (rtc_date.mon > 2 ? -3 : 9)) + 2) / 5 + rtc_date.day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    uint32_t days = era * 146097 + doe - 730425; // 730425 = days from 0000-03-01 to 2000-01-01
+    return days * 86400 + rtc_time.hour * 3600 + rtc_time.min * 60 + rtc_time.sec;
+}
+
+bool loadState()
+{
+    have_loaded = false;
+    if (state_valid(rtc_state)) {
+        loaded = rtc_state;
+        have_loaded = true;
+    }
+
+    SDFile file = SD.open(STATE_PATH, FILE_READ);
+    if (file) {
+        persisted_state_t from_sd;
+        if (file.read((uint8_t*)&from_sd, sizeof(from_sd)) == sizeof(from_sd) && state_valid(from_sd)) {
+            sd_checksum = readings_checksum(from_sd);
+            if (!have_loaded || from_sd.saved_at > loaded.saved_at) {
+                loaded = from_sd;
+                have_loaded = true;
+            }
+        }
+        file.close();
+    }
+    return have_loaded;
+}
+
+bool stateShowsDashboard()
+{
+    return have_loaded && loaded.dashboard_drawn;
+}
+
+void markDashboardOverwritten()
+{
+    if (state_valid(rtc_state) && rtc_state.dashboard_drawn) {
+        rtc_state.dashboard_drawn = 0;
+        rtc_state.checksum = state_checksum(rtc_state);
+    }
+
+    SDFile file = SD.open(STATE_PATH, FILE_READ);
+    if (!file)
+        return;
+    persisted_state_t from_sd;
+    bool rewrite = file.read((uint8_t*)&from_sd, sizeof(from_sd)) == sizeof(from_sd) && state_valid(from_sd)
+        && from_sd.dashboard_drawn;
+    file.close();
+    if (!rewrite)
+        return;
+    from_sd.dashboard_drawn = 0;
+    from_sd.checksum = state_checksum(from_sd);
+    file = SD.open(STATE_PATH, FILE_WRITE);
+    if (!file)
+        return;
+    file.write((const uint8_t*)&from_sd, sizeof(from_sd));
+    file.close();
+    sd_checksum = readings_checksum(from_sd);
+}
+
+bool stateMatchesLayout(int row_height, int row_padding)
+{
+    return have_loaded && loaded.row_height == row_height && loaded.row_padding == row_padding;
+}
+
+unsigned stateDrawnRows()
+{
+    return have_loaded ? loaded.drawn_rows : 0;
+}
+
+void restoreSensors(std::vector<prst_sensor_data_t>& sensors, unsigned long now, unsigned long timeout,
+    unsigned long stale_after)
+{
+    if (!have_loaded)
+        return;
+
+    uint32_t rtc_now = rtc_seconds();
+    bool elapsed_known = loaded.saved_at != 0 && rtc_now >= loaded.saved_at;
+    uint32_t elapsed_s = elapsed_known ? rtc_now - loaded.saved_at : 0;
+
+    for (size_t i = 0; i < loaded.count; ++i) {
+        const persisted_sensor_t& saved = loaded.sensors[i];
+        // Compare in seconds first: after a few weeks switched off the age no
+        // longer fits in 32-bit milliseconds.
+        uint64_t age_s = (uint64_t)saved.age_s + elapsed_s;
+        if (age_s > timeout / 1000)
+            continue;
+        unsigned long age_ms = age_s * 1000;
+        if (!elapsed_known)
+            age_ms = max(age_ms, stale_after);
+        if (age_ms > timeout)
+            continue;
+
+        prst_sensor_data_t sensor;
+        memcpy(sensor.mac_addr.bytes, saved.mac, 6);
+        sensor.protocol = (sensor_protocol_t)saved.protocol;
+        sensor.protocol_version = saved.protocol_version;
+        sensor.has_light_sensor = saved.flags & FLAG_LIGHT;
+        sensor.has_soil_sensor = saved.flags & FLAG_SOIL;
+        sensor.run_counter = saved.run_counter;
+        sensor.batt_mv = saved.batt_mv;
+        sensor.temp_c = saved.temp_centi / 100.0f;
+        sensor.humi = saved.humi;
+        sensor.soil_moisture = saved.soil_moisture;
+        sensor.light = saved.light;
+        // Alias ids index the table built from sensors.txt, which may have
+        // changed since the checkpoint.
+        sensor.alias_id = sensor_aliases.find(sensor.mac_addr.to_u64());
+        sensor.timestamp = now - age_ms;
+        sensors.push_back(sensor);
+    }
+}
+
+void checkpointState(const std::vector<prst_sensor_data_t>& sensors, unsigned drawn_rows, unsigned long now)
+{
+    persisted_state_t& state = rtc_state;
+    memset(&state, 0, sizeof(state));
+    state.magic = STATE_MAGIC;
+    state.version = STATE_VERSION;
+    state.saved_at = rtc_seconds();
+    state.row_height = ROW_HEIGHT;
+    state.row_padding = ROW_PADDING;
+    state.drawn_rows = min(drawn_rows, 255u);
+    state.dashboard_drawn = 1;
+
+    for (const auto& sensor : sensors) {
+        if (state.count == MAX_PERSISTED_SENSORS)
+            break;
+        persisted_sensor_t& saved = state.sensors[state.count++];
+        memcpy(saved.mac, sensor.mac_addr.bytes, 6);
+        saved.protocol = sensor.protocol;
+        saved.protocol_version = sensor.protocol_version;
+        saved.flags = (sensor.has_light_sensor ? FLAG_LIGHT : 0) | (sensor.has_soil_sensor ? FLAG_SOIL : 0);
+        saved.run_counter = sensor.run_counter;
+        saved.batt_mv = sensor.batt_mv;
+        saved.temp_centi = (int16_t)lroundf(sensor.temp_c * 100.0f);
+        saved.humi = sensor.humi;
+        saved.soil_moisture = sensor.soil_moisture;
+        saved.light = sensor.light;
+        // Adverts are stamped on the BLE task, so one can be newer than `now`.
+        long age_ms = (long)(now - sensor.timestamp);
+        saved.age_s = age_ms > 0 ? age_ms / 1000 : 0;
+    }
+    state.checksum = state_checksum(state);
+
+    uint32_t checksum = readings_checksum(state);
+    if (checksum == sd_checksum)
+        return;
+
+    SDFile file = SD.open(STATE_PATH, FILE_WRITE);
+    if (!file)
+        return;
+    file.write((const uint8_t*)&state, sizeof(state));
+    file.close();
+    sd_checksum = checksum;
+}
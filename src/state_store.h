@@ -0,0 +1,40 @@
+#ifndef _STATE_STORE_H_
+#define _STATE_STORE_H_
+
+#include <vector>
+
+#include "prst_data.h"
+
+// Checkpoints the sensor registry and what is on the panel, so a reset or
+// power cycle can redraw the last known dashboard without waiting for new
+// adverts. The checkpoint is kept in RTC slow memory, which survives resets
+// and deep sleep, and mirrored to the SD card for power loss.
+
+// Load the newest valid checkpoint. Returns false if there is none.
+bool loadState();
+
+// True if the panel was left showing the loaded checkpoint's dashboard, rather
+// than boot messages from a setup that never finished.
+bool stateShowsDashboard();
+
+// Call before drawing anything other than the dashboard, so a reset before the
+// next checkpoint does a full redraw instead of a quiet boot.
+void markDashboardOverwritten();
+
+// True if the loaded checkpoint was drawn with this layout, meaning the
+// panel still shows it and does not need a full clear.
+bool stateMatchesLayout(int row_height, int row_padding);
+
+// Number of sensor rows on the panel when the checkpoint was taken.
+unsigned stateDrawnRows();
+
+// Append the checkpointed readings to `sensors`, dropping any older than
+// `timeout`. Readings whose age can't be determined are aged to `stale_after`.
+void restoreSensors(std::vector<prst_sensor_data_t>& sensors, unsigned long now, unsigned long timeout,
+    unsigned long stale_after);
+
+// Save the registry to RTC memory, and to the SD card if it changed. Only call
+// this once a complete frame of the dashboard is on the panel.
+void checkpointState(const std::vector<prst_sensor_data_t>& sensors, unsigned drawn_rows, unsigned long now);
+
+#endif // _STATE_STORE_H_
@@ -4,38 +4,15 @@
 // https://opensource.org/licenses/MIT
 
 #include "time_util.h"
-
-extern std::string FONT_FACE;
-extern int FONT_SIZE;
-extern int ROW_HEIGHT;
-extern int ROW_PADDING;
+#include "local_sensors.h"
+#include "widgets.h"
+#include <sys/time.h>
 
 time_t t;
 struct tm* tm;
 
 static const char* wd[7] = { "Sun", "Mon", "Tue", "Wed", "Thr", "Fri", "Sat" };
 
-void drawDateTime(const char* timeStr)
-{
-    int width = 800;
-    int height = ROW_HEIGHT;
-    int bgcolor = 15;
-    int fgcolor = 0;
-    int ofsetY = (60 - height) / 2;
-    int fontSize = ROW_HEIGHT;
-    M5EPD_Canvas canvas(&M5.EPD);
-    canvas.loadFont(FONT_FACE.c_str(), SD);
-    canvas.createRender(fontSize, 256);
-
-    canvas.createCanvas(width, height);
-    canvas.fillCanvas(bgcolor);
-    canvas.setTextSize(fontSize);
-    canvas.setTextColor(fgcolor, bgcolor);
-    canvas.drawString(timeStr, 0, 0);
-    canvas.pushCanvas(20, ofsetY, UPDATE_MODE_A2);
-    canvas.deleteCanvas();
-}
-
 void setupRTCTime()
 {
     t = time(NULL);
@@ -52,14 +29,35 @@ void setupRTCTime()
     M5.RTC.setDate(&RTCDate);
 }
 
+void setupSystemTime()
+{
+    M5.RTC.getTime(&RTCtime);
+    M5.RTC.getDate(&RTCDate);
+
+    struct tm rtc_tm = {};
+    rtc_tm.tm_hour = RTCtime.hour;
+    rtc_tm.tm_min = RTCtime.min;
+    rtc_tm.tm_sec = RTCtime.sec;
+    rtc_tm.tm_year = RTCDate.year - 1900;
+    rtc_tm.tm_mon = RTCDate.mon - 1;
+    rtc_tm.tm_mday = RTCDate.day;
+    rtc_tm.tm_isdst = -1;
+
+    struct timeval tv = { mktime(&rtc_tm), 0 };
+    settimeofday(&tv, NULL);
+}
+
 char lastTime[23] = "0000/00/00 (000) 00:00";
 
 void showDateTime()
 {
     char currentTime[23];
+    struct tm now;
+    if (!local_sensors.local_time(&now))
+        return;
 
-    sprintf(currentTime, "%d/%02d/%02d (%s) %02d:%02d", RTCDate.year, RTCDate.mon, RTCDate.day, wd[RTCDate.week],
-        RTCtime.hour, RTCtime.min);
+    sprintf(currentTime, "%d/%02d/%02d (%s) %02d:%02d", now.tm_year + 1900, now.tm_mon + 1, now.tm_mday,
+        wd[now.tm_wday], now.tm_hour, now.tm_min);
     if (strcmp(lastTime, currentTime) != 0) {
         drawDateTime(currentTime);
         strcpy(lastTime, currentTime);
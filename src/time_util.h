@@ -11,6 +11,7 @@ extern rtc_time_t RTCtime;
 extern rtc_date_t RTCDate;
 
 void setupRTCTime();
+void setupSystemTime();
 void showDateTime();
 
 #endif
@@ -0,0 +1,35 @@
+#ifndef _UTF8_H_
+#define _UTF8_H_
+
+#include <cstdint>
+
+// Decode one UTF-8 sequence, advancing `text`. Returns 0 at the end of the string.
+static inline uint32_t next_codepoint(const char*& text)
+{
+    const uint8_t* p = (const uint8_t*)text;
+    if (*p == 0)
+        return 0;
+    uint32_t cp;
+    int extra;
+    if (*p < 0x80) {
+        cp = *p;
+        extra = 0;
+    } else if ((*p & 0xe0) == 0xc0) {
+        cp = *p & 0x1f;
+        extra = 1;
+    } else if ((*p & 0xf0) == 0xe0) {
+        cp = *p & 0x0f;
+        extra = 2;
+    } else {
+        cp = *p & 0x07;
+        extra = 3;
+    }
+    ++p;
+    for (; extra > 0 && (*p & 0xc0) == 0x80; --extra, ++p) {
+        cp = (cp << 6) | (*p & 0x3f);
+    }
+    text = (const char*)p;
+    return cp;
+}
+
+#endif // _UTF8_H_
@@ -0,0 +1,124 @@
+#include "widgets.h"
+
+#include "render.h"
+
+#include <cstdio>
+
+// Row layout, overridden from config.txt at boot.
+int ROW_HEIGHT = 60;
+int ROW_PADDING = 5;
+
+void drawRow(const char* text, int y, int fontSize, int fgcolor, int bgcolor)
+{
+    int margin = ROW_PADDING;
+    if (fontSize == 0)
+        fontSize = ROW_HEIGHT - margin * 2;
+
+    render_text_t texts[] = { { text, 20, margin } };
+    render_block_t block
+        = { "row", 0, y, SCREEN_WIDTH, ROW_HEIGHT, fontSize, fgcolor, bgcolor, RENDER_MODE_GLR16, texts, 1 };
+    renderBlock(block);
+}
+
+void drawRow(const std::string& text, int y, int fontSize, int fgcolor, int bgcolor)
+{
+    drawRow(text.c_str(), y, fontSize, fgcolor, bgcolor);
+}
+
+void drawHeader(const char* title, int y, int fgcolor, int bgcolor)
+{
+    drawRow(title, y, ROW_HEIGHT, fgcolor, bgcolor);
+}
+
+void drawHeader(const std::string& title, int y, int fgcolor, int bgcolor)
+{
+    drawHeader(title.c_str(), y, fgcolor, bgcolor);
+}
+
+void drawSensorRow(const char* line, const char* indicator, int y, int fgcolor)
+{
+    int fontSize = 30;
+    int margin = ROW_PADDING;
+    // The indicator clears its column, so a long reading is cut off there
+    // rather than drawn under it.
+    int indicator_width = 130;
+    render_text_t texts[]
+        = { { line, 20, margin }, { indicator, SCREEN_WIDTH - indicator_width, margin, indicator_width } };
+    render_block_t block
+        = { "row", 0, y, SCREEN_WIDTH, ROW_HEIGHT, fontSize, fgcolor, 0, RENDER_MODE_GLR16, texts, 2 };
+    renderBlock(block);
+}
+
+void drawDateTime(const char* timeStr)
+{
+    int width = 800;
+    int height = ROW_HEIGHT;
+    int bgcolor = 15;
+    int fgcolor = 0;
+    int ofsetY = (60 - height) / 2;
+    int fontSize = ROW_HEIGHT;
+    render_text_t texts[] = { { timeStr, 0, 0 } };
+    render_block_t block
+        = { "datetime", 20, ofsetY, width, height, fontSize, fgcolor, bgcolor, RENDER_MODE_A2, texts, 1 };
+    renderBlock(block);
+}
+
+void drawBattery(const std::string& battery)
+{
+    int width = 40;
+    int height = ROW_HEIGHT;
+    int bgcolor = 15;
+    int fgcolor = 0;
+    int fontSize = ROW_HEIGHT;
+    render_text_t texts[] = { { battery.c_str(), 0, 0 } };
+    render_block_t block = { "battery", SCREEN_WIDTH - width - ROW_PADDING, 0, width, height, fontSize, fgcolor,
+        bgcolor, RENDER_MODE_A2, texts, 1 };
+    renderBlock(block);
+}
+
+void drawWiFi(bool connected)
+{
+    int width = 50;
+    int height = ROW_HEIGHT;
+    int bgcolor = 15;
+    int fgcolor = 0;
+    int fontSize = 45;
+
+    const char* wifi_conn = connected ? "直" : "睊";
+    render_text_t texts[] = { { wifi_conn, 0, ROW_PADDING } };
+    render_block_t block = { "wifi", SCREEN_WIDTH - 200 - width - ROW_PADDING, 0, width, height, fontSize, fgcolor,
+        bgcolor, RENDER_MODE_A2, texts, 1 };
+    renderBlock(block);
+}
+
+void drawTemperature(const char* temperature)
+{
+    int width = 130;
+    int height = ROW_HEIGHT;
+    int bgcolor = 15;
+    int fgcolor = 0;
+    int fontSize = 45;
+
+    render_text_t texts[] = { { temperature, 0, ROW_PADDING } };
+    render_block_t block = { "temperature", SCREEN_WIDTH - 50 - width - ROW_PADDING, 0, width, height, fontSize,
+        fgcolor, bgcolor, RENDER_MODE_A2, texts, 1 };
+    renderBlock(block);
+}
+
+void drawDeviceCounts(unsigned seen, size_t valid)
+{
+    char seen_str[16];
+    snprintf(seen_str, sizeof(seen_str), "%4u seen", seen);
+    char valid_str[16];
+    snprintf(valid_str, sizeof(valid_str), "%4u valid", (unsigned)valid);
+
+    int width = 400;
+    int height = 30;
+    int bgcolor = 10;
+    int fgcolor = 0;
+    int fontSize = height;
+    render_text_t texts[] = { { seen_str, 0, 0 }, { valid_str, width / 2, 0 } };
+    render_block_t block = { "counts", SCREEN_WIDTH - width - ROW_PADDING, ROW_HEIGHT + 25, width, height, fontSize,
+        fgcolor, bgcolor, RENDER_MODE_A2, texts, 2 };
+    renderBlock(block);
+}
@@ -0,0 +1,25 @@
+#ifndef _WIDGETS_H_
+#define _WIDGETS_H_
+
+#include <cstddef>
+#include <string>
+
+// Layout of every dashboard widget. These only turn values into render
+// blocks; deciding when to redraw is up to the callers.
+
+void drawRow(const char* text, int y, int fontSize = 0, int fgcolor = 15, int bgcolor = 0);
+void drawRow(const std::string& text, int y, int fontSize = 0, int fgcolor = 15, int bgcolor = 0);
+void drawHeader(const char* title, int y = 0, int fgcolor = 15, int bgcolor = 0);
+void drawHeader(const std::string& title, int y = 0, int fgcolor = 15, int bgcolor = 0);
+
+// A sensor row: the reading on the left and a link quality indicator on the right.
+void drawSensorRow(const char* line, const char* indicator, int y, int fgcolor);
+
+// Header bar widgets.
+void drawDateTime(const char* timeStr);
+void drawBattery(const std::string& battery);
+void drawWiFi(bool connected);
+void drawTemperature(const char* temperature);
+void drawDeviceCounts(unsigned seen, size_t valid);
+
+#endif // _WIDGETS_H_
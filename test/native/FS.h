@@ -0,0 +1,43 @@
+// Host stand-in for the Arduino <FS.h>, backed by stdio. Paths are host paths.
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+#define FILE_READ "rb"
+
+namespace fs {
+
+class File {
+public:
+    File(FILE* file = nullptr)
+        : file(file)
+    {
+    }
+    explicit operator bool() const { return file != nullptr; }
+    size_t size()
+    {
+        long pos = ftell(file);
+        fseek(file, 0, SEEK_END);
+        long len = ftell(file);
+        fseek(file, pos, SEEK_SET);
+        return len;
+    }
+    size_t read(uint8_t* buffer, size_t len) { return fread(buffer, 1, len, file); }
+    void close()
+    {
+        if (file != nullptr)
+            fclose(file);
+        file = nullptr;
+    }
+
+private:
+    FILE* file;
+};
+
+class FS {
+public:
+    File open(const char* path, const char* mode) { return File(fopen(path, mode)); }
+};
+
+} // namespace fs
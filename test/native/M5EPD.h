@@ -0,0 +1,35 @@
+// Host stand-in for <M5EPD.h>, just enough for the device-independent sources
+// built by the native test environment. Each test defines millis().
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+unsigned long millis();
+
+inline void* ps_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+// Records pixels at the panel's 16 grey levels, 0 = white, clipped to its size.
+class M5EPD_Canvas {
+public:
+    M5EPD_Canvas(int width, int height)
+        : width(width)
+        , height(height)
+        , pixels(width * height)
+    {
+    }
+    void drawPixel(int32_t x, int32_t y, uint32_t color)
+    {
+        if (x >= 0 && x < width && y >= 0 && y < height)
+            pixels[y * width + x] = color;
+    }
+
+    int width;
+    int height;
+    std::vector<uint8_t> pixels;
+};
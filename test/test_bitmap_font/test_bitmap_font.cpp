@@ -0,0 +1,148 @@
+#include <unity.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bitmap_font.h"
+#include "render.h"
+
+// Checks that atlases written by tools/font_atlas.py load in BitmapFont and
+// draw the same pixels as the FreeType host backend, which rasterizes the TTF
+// the way the tool does. monofur_30.m5fa was built with
+//
+//     tools/font_atlas.py card_skeleton/monofur_nf.ttf test/test_bitmap_font/monofur_30.m5fa --sizes 30 --chars "°—"
+//
+// and needs rebuilding whenever the tool's output format changes.
+
+extern std::string FONT_FACE;
+
+static const char* SAMPLE = "Kitchen basil — 42%, 71.2°F";
+static const int SIZE = 30;
+
+unsigned long millis()
+{
+    return 0;
+}
+
+static std::string test_dir()
+{
+    std::string file = __FILE__;
+    size_t slash = file.find_last_of('/');
+    return slash == std::string::npos ? std::string(".") : file.substr(0, slash);
+}
+
+static std::vector<uint8_t> read_file(const std::string& path)
+{
+    std::vector<uint8_t> data;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return data;
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + n);
+    }
+    fclose(file);
+    return data;
+}
+
+static bool load_bytes(BitmapFont& font, const std::vector<uint8_t>& data)
+{
+    std::string path = test_dir() + "/modified.m5fa";
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+    fs::FS host;
+    bool ok = font.load(host, path.c_str());
+    remove(path.c_str());
+    return ok;
+}
+
+static std::vector<uint8_t> atlas;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_loads_tool_output()
+{
+    TEST_ASSERT_FALSE_MESSAGE(atlas.empty(), "missing monofur_30.m5fa");
+    BitmapFont font;
+    TEST_ASSERT_TRUE(load_bytes(font, atlas));
+    TEST_ASSERT_TRUE(font.covers(SAMPLE, SIZE));
+    TEST_ASSERT_FALSE(font.covers(SAMPLE, SIZE + 1));
+    TEST_ASSERT_FALSE(font.covers("\xe2\x98\x83", SIZE)); // U+2603 is not in the atlas
+}
+
+void test_matches_freetype()
+{
+    BitmapFont font;
+    TEST_ASSERT_TRUE(load_bytes(font, atlas));
+    M5EPD_Canvas canvas(SCREEN_WIDTH, 60);
+    font.draw(canvas, SAMPLE, 10, 5, SIZE, 15, 0);
+
+    render_text_t text = { SAMPLE, 10, 5 };
+    render_block_t block = { "atlas", 0, 0, SCREEN_WIDTH, 60, SIZE, 15, 0, RENDER_MODE_GLR16, &text, 1 };
+    renderBlock(block);
+
+    const uint8_t* fb = renderSnapshot();
+    size_t differing = 0;
+    size_t inked = 0;
+    for (int y = 0; y < canvas.height; ++y) {
+        for (int x = 0; x < canvas.width; ++x) {
+            uint8_t byte = fb[(y * SCREEN_WIDTH + x) / 2];
+            uint8_t expected = (x & 1) ? byte & 0x0f : byte >> 4;
+            uint8_t actual = canvas.pixels[y * canvas.width + x];
+            differing += actual != expected;
+            inked += actual != 0;
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(1000, inked);
+    TEST_ASSERT_EQUAL(0, differing);
+}
+
+void test_rejects_short_file()
+{
+    BitmapFont font;
+    std::vector<uint8_t> data(atlas.begin(), atlas.end() - 64);
+    TEST_ASSERT_FALSE(load_bytes(font, data));
+}
+
+void test_rejects_glyph_past_end()
+{
+    // Point the last glyph's bitmap just past the end of the file; the tables
+    // themselves are still in bounds.
+    std::vector<uint8_t> data = atlas;
+    uint16_t glyph_count;
+    uint32_t glyphs, bitmaps;
+    memcpy(&glyph_count, &data[8 + 6], 2);
+    memcpy(&glyphs, &data[8 + 12], 4);
+    memcpy(&bitmaps, &data[8 + 20], 4);
+    uint32_t offset = data.size() - bitmaps - 1;
+    memcpy(&data[glyphs + (glyph_count - 1) * 16 + 12], &offset, 4);
+
+    BitmapFont font;
+    TEST_ASSERT_FALSE(load_bytes(font, data));
+}
+
+int main()
+{
+    FONT_FACE = test_dir() + "/../../card_skeleton/monofur_nf.ttf";
+    atlas = read_file(test_dir() + "/monofur_30.m5fa");
+
+    UNITY_BEGIN();
+    RUN_TEST(test_loads_tool_output);
+    RUN_TEST(test_matches_freetype);
+    RUN_TEST(test_rejects_short_file);
+    RUN_TEST(test_rejects_glyph_past_end);
+    return UNITY_END();
+}
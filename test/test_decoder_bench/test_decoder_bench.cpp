@@ -0,0 +1,78 @@
+#include <unity.h>
+
+#include <chrono>
+#include <cstdio>
+
+#include "advert_decoders.h"
+
+// Decode throughput over a mix of every supported protocol plus adverts that no
+// decoder claims, which is what most of a busy scan looks like.
+
+unsigned long millis()
+{
+    return 0;
+}
+
+static const char PLANT[] = "\xf0\x9f\x8c\xb1";
+static const mac_addr_t PARASITE_MAC = { { 0xf0, 0xca, 0xfe, 0x00, 0x11, 0x22 } };
+static const mac_addr_t ATC_MAC = { { 0xa4, 0xc1, 0x38, 0x01, 0x02, 0x03 } };
+
+static const uint8_t BPARASITE_V2[] = { 0x21, 0x05, 0x0b, 0xb8, 0x08, 0xfc, 0x80, 0x00, 0x40, 0x00, 0xf0, 0xca, 0xfe,
+    0x00, 0x11, 0x22, 0x01, 0x2c };
+static const uint8_t BPARASITE_V1[] = { 0x11, 0x03, 0x0b, 0xb8, 0x5a, 0x3c, 0x80, 0x00, 0x40, 0x00, 0xf0, 0xca, 0xfe,
+    0x00, 0x11, 0x22, 0x00, 0x64 };
+static const uint8_t BTHOME[] = { 0x40, 0x00, 0x2a, 0x01, 0x5d, 0x02, 0xca, 0x09, 0x03, 0xbf, 0x13, 0x05, 0x13, 0x8a,
+    0x14, 0x0c, 0x54, 0x0b };
+static const uint8_t ATC1441[] = { 0xa4, 0xc1, 0x38, 0x01, 0x02, 0x03, 0x00, 0xeb, 0x32, 0x55, 0x0b, 0xb8, 0x07 };
+static const uint8_t PVVX[] = { 0x03, 0x02, 0x01, 0x38, 0xc1, 0xa4, 0x2e, 0x09, 0x88, 0x13, 0xb8, 0x0b, 0x55, 0x09,
+    0x04 };
+static const uint8_t OTHER[] = { 0x06, 0x00, 0x01, 0x09, 0x20, 0x02, 0x4d, 0x3b, 0x7a, 0x11, 0x8c, 0x2e };
+
+static const advert_t ADVERTS[] = {
+    { PLANT, 4, 0, BPARASITE_V2, sizeof(BPARASITE_V2), PARASITE_MAC },
+    { PLANT, 4, 0, BPARASITE_V1, sizeof(BPARASITE_V1), PARASITE_MAC },
+    { nullptr, 0, 0xfcd2, BTHOME, sizeof(BTHOME), ATC_MAC },
+    { nullptr, 0, 0x181a, ATC1441, sizeof(ATC1441), ATC_MAC },
+    { nullptr, 0, 0x181a, PVVX, sizeof(PVVX), ATC_MAC },
+    { "LE-Bose", 7, 0xfe9f, OTHER, sizeof(OTHER), ATC_MAC },
+    { nullptr, 0, 0, OTHER, sizeof(OTHER), ATC_MAC },
+    { nullptr, 0, 0, nullptr, 0, PARASITE_MAC },
+};
+static const size_t ADVERT_COUNT = sizeof(ADVERTS) / sizeof(ADVERTS[0]);
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_decode_throughput()
+{
+    const size_t rounds = 200000;
+    size_t decoded = 0;
+    prst_sensor_data_t out;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < ADVERT_COUNT; ++i) {
+            decoded += advert_decoders::decode(ADVERTS[i], out);
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    TEST_ASSERT_EQUAL(rounds * 5, decoded);
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    char message[96];
+    snprintf(message, sizeof(message), "%.1f M adverts/s, %.1f ns per advert", rounds * ADVERT_COUNT / seconds / 1e6,
+        seconds * 1e9 / (rounds * ADVERT_COUNT));
+    TEST_MESSAGE(message);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_decode_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,228 @@
+#include <unity.h>
+
+#include "advert_decoders.h"
+
+unsigned long millis()
+{
+    return 1000;
+}
+
+static const char PLANT[] = "\xf0\x9f\x8c\xb1";
+static const mac_addr_t PARASITE_MAC = { { 0xf0, 0xca, 0xfe, 0x00, 0x11, 0x22 } };
+static const mac_addr_t ATC_MAC = { { 0xa4, 0xc1, 0x38, 0x01, 0x02, 0x03 } };
+
+static advert_t make_advert(const char* name, uint16_t uuid, const uint8_t* data, size_t len, mac_addr_t address)
+{
+    advert_t advert = { name, name ? strlen(name) : 0, uuid, data, len, address };
+    return advert;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// v2: light flag, counter 5, 3000 mV, 23.00 C, 50% RH, 25% soil, 300 lux.
+static const uint8_t BPARASITE_V2[] = { 0x21, 0x05, 0x0b, 0xb8, 0x08, 0xfc, 0x80, 0x00, 0x40, 0x00, 0xf0, 0xca, 0xfe,
+    0x00, 0x11, 0x22, 0x01, 0x2c };
+
+void test_bparasite_v2()
+{
+    prst_sensor_data_t out;
+    advert_t advert = make_advert(PLANT, 0x181a, BPARASITE_V2, sizeof(BPARASITE_V2), PARASITE_MAC);
+    TEST_ASSERT_TRUE(advert_decoders::decode(advert, out));
+    TEST_ASSERT_EQUAL(PROTOCOL_BPARASITE_V2, out.protocol);
+    TEST_ASSERT_EQUAL_UINT8(5, out.run_counter);
+    TEST_ASSERT_EQUAL_UINT16(3000, out.batt_mv);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 23.0f, out.temp_c);
+    TEST_ASSERT_EQUAL_UINT16(0x8000, out.humi);
+    TEST_ASSERT_EQUAL_UINT16(0x4000, out.soil_moisture);
+    TEST_ASSERT_TRUE(out.has_light_sensor);
+    TEST_ASSERT_EQUAL_UINT16(300, out.light);
+    TEST_ASSERT_TRUE(out.mac_addr == PARASITE_MAC);
+}
+
+void test_bparasite_v2_negative_temperature()
+{
+    uint8_t data[sizeof(BPARASITE_V2)];
+    memcpy(data, BPARASITE_V2, sizeof(data));
+    data[4] = 0xfe; // -5.00 C
+    data[5] = 0x0c;
+    prst_sensor_data_t out;
+    TEST_ASSERT_TRUE(advert_decoders::decode(make_advert(PLANT, 0, data, sizeof(data), PARASITE_MAC), out));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -5.0f, out.temp_c);
+}
+
+void test_bparasite_v2_rejects_missing_light()
+{
+    prst_sensor_data_t out;
+    TEST_ASSERT_FALSE(advert_decoders::decode(make_advert(PLANT, 0, BPARASITE_V2, 16, PARASITE_MAC), out));
+}
+
+// v1 is laid out like v2, with millidegrees: counter 3, 3000 mV, 23.100 C,
+// 50% RH, 25% soil, 100 lux.
+static const uint8_t BPARASITE_V1[] = { 0x11, 0x03, 0x0b, 0xb8, 0x5a, 0x3c, 0x80, 0x00, 0x40, 0x00, 0xf0, 0xca, 0xfe,
+    0x00, 0x11, 0x22, 0x00, 0x64 };
+
+void test_bparasite_v1()
+{
+    prst_sensor_data_t out;
+    advert_t advert = make_advert(PLANT, 0x181a, BPARASITE_V1, sizeof(BPARASITE_V1), PARASITE_MAC);
+    TEST_ASSERT_TRUE(advert_decoders::decode(advert, out));
+    TEST_ASSERT_EQUAL(PROTOCOL_BPARASITE_V1, out.protocol);
+    TEST_ASSERT_EQUAL_UINT8(1, out.protocol_version);
+    TEST_ASSERT_EQUAL_UINT8(3, out.run_counter);
+    TEST_ASSERT_EQUAL_UINT16(3000, out.batt_mv);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 23.1f, out.temp_c);
+    TEST_ASSERT_EQUAL_UINT16(0x8000, out.humi);
+    TEST_ASSERT_EQUAL_UINT16(0x4000, out.soil_moisture);
+    TEST_ASSERT_TRUE(out.has_light_sensor);
+    TEST_ASSERT_EQUAL_UINT16(100, out.light);
+    TEST_ASSERT_TRUE(out.mac_addr == PARASITE_MAC);
+}
+
+void test_bparasite_v1_without_light()
+{
+    uint8_t data[16];
+    memcpy(data, BPARASITE_V1, sizeof(data));
+    data[0] = 0x10;
+    prst_sensor_data_t out;
+    TEST_ASSERT_TRUE(advert_decoders::decode(make_advert(PLANT, 0, data, sizeof(data), PARASITE_MAC), out));
+    TEST_ASSERT_FALSE(out.has_light_sensor);
+    TEST_ASSERT_EQUAL_UINT16(0, out.light);
+}
+
+void test_bparasite_v1_rejects_short()
+{
+    prst_sensor_data_t out;
+    TEST_ASSERT_FALSE(advert_decoders::decode(make_advert(PLANT, 0, BPARASITE_V1, 12, PARASITE_MAC), out));
+    TEST_ASSERT_FALSE(advert_decoders::decode(make_advert(PLANT, 0, BPARASITE_V1, 17, PARASITE_MAC), out));
+}
+
+void test_bparasite_needs_name()
+{
+    prst_sensor_data_t out;
+    advert_t advert = make_advert("other", 0, BPARASITE_V2, sizeof(BPARASITE_V2), PARASITE_MAC);
+    TEST_ASSERT_FALSE(advert_decoders::decode(advert, out));
+}
+
+// BTHome v2, unencrypted: packet id 42, battery 93%, 25.06 C, 50.55% RH,
+// 13460.67 lux, 2.9 V.
+static const uint8_t BTHOME[] = { 0x40, 0x00, 0x2a, 0x01, 0x5d, 0x02, 0xca, 0x09, 0x03, 0xbf, 0x13, 0x05, 0x13, 0x8a,
+    0x14, 0x0c, 0x54, 0x0b };
+
+void test_bthome_v2()
+{
+    prst_sensor_data_t out;
+    TEST_ASSERT_TRUE(advert_decoders::decode(make_advert(nullptr, 0xfcd2, BTHOME, sizeof(BTHOME), ATC_MAC), out));
+    TEST_ASSERT_EQUAL(PROTOCOL_BTHOME_V2, out.protocol);
+    TEST_ASSERT_EQUAL_UINT8(42, out.run_counter);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 25.06f, out.temp_c);
+    TEST_ASSERT_EQUAL_UINT16(5055u * 65535 / 10000, out.humi);
+    TEST_ASSERT_TRUE(out.has_light_sensor);
+    TEST_ASSERT_EQUAL_UINT16(13460, out.light);
+    TEST_ASSERT_EQUAL_UINT16(2900, out.batt_mv);
+    TEST_ASSERT_FALSE(out.has_soil_sensor);
+    TEST_ASSERT_TRUE(out.mac_addr == ATC_MAC);
+}
+
+void test_bthome_v2_rejects_encrypted()
+{
+    uint8_t data[sizeof(BTHOME)];
+    memcpy(data, BTHOME, sizeof(data));
+    data[0] = 0x41;
+    prst_sensor_data_t out;
+    TEST_ASSERT_FALSE(advert_decoders::decode(make_advert(nullptr, 0xfcd2, data, sizeof(data), ATC_MAC), out));
+}
+
+void test_bthome_v2_rejects_short()
+{
+    prst_sensor_data_t out;
+    // Device info only, then a temperature object cut off mid-value.
+    TEST_ASSERT_FALSE(advert_decoders::decode(make_advert(nullptr, 0xfcd2, BTHOME, 0, ATC_MAC), out));
+    TEST_ASSERT_FALSE(advert_decoders::decode(make_advert(nullptr, 0xfcd2, BTHOME, 1, ATC_MAC), out));
+    static const uint8_t truncated[] = { 0x40, 0x02, 0xca };
+    TEST_ASSERT_FALSE(advert_decoders::decode(make_advert(nullptr, 0xfcd2, truncated, 3, ATC_MAC), out));
+}
+
+void test_bthome_v2_stops_at_unknown_object()
+{
+    // The temperature before the unknown id 0xf0 is still used.
+    static const uint8_t data[] = { 0x40, 0x02, 0xca, 0x09, 0xf0, 0x01, 0x03, 0xbf, 0x13 };
+    prst_sensor_data_t out;
+    TEST_ASSERT_TRUE(advert_decoders::decode(make_advert(nullptr, 0xfcd2, data, sizeof(data), ATC_MAC), out));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 25.06f, out.temp_c);
+    TEST_ASSERT_EQUAL_UINT16(0, out.humi);
+}
+
+// atc1441: big-endian, MAC first, 23.5 C, 50% RH, 85%, 3000 mV, counter 7.
+static const uint8_t ATC1441[] = { 0xa4, 0xc1, 0x38, 0x01, 0x02, 0x03, 0x00, 0xeb, 0x32, 0x55, 0x0b, 0xb8, 0x07 };
+
+void test_atc1441()
+{
+    prst_sensor_data_t out;
+    TEST_ASSERT_TRUE(advert_decoders::decode(make_advert(nullptr, 0x181a, ATC1441, sizeof(ATC1441), ATC_MAC), out));
+    TEST_ASSERT_EQUAL(PROTOCOL_ATC, out.protocol);
+    TEST_ASSERT_EQUAL_UINT8(1, out.protocol_version);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 23.5f, out.temp_c);
+    TEST_ASSERT_EQUAL_UINT16(50u * 65535 / 100, out.humi);
+    TEST_ASSERT_EQUAL_UINT16(3000, out.batt_mv);
+    TEST_ASSERT_EQUAL_UINT8(7, out.run_counter);
+    TEST_ASSERT_TRUE(out.mac_addr == ATC_MAC);
+}
+
+// pvvx: little-endian, MAC reversed, 23.50 C, 50.00% RH, 3000 mV, 85%,
+// counter 9, flags.
+static const uint8_t PVVX[] = { 0x03, 0x02, 0x01, 0x38, 0xc1, 0xa4, 0x2e, 0x09, 0x88, 0x13, 0xb8, 0x0b, 0x55, 0x09,
+    0x04 };
+
+void test_atc_pvvx()
+{
+    prst_sensor_data_t out;
+    TEST_ASSERT_TRUE(advert_decoders::decode(make_advert(nullptr, 0x181a, PVVX, sizeof(PVVX), ATC_MAC), out));
+    TEST_ASSERT_EQUAL(PROTOCOL_ATC, out.protocol);
+    TEST_ASSERT_EQUAL_UINT8(2, out.protocol_version);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 23.5f, out.temp_c);
+    TEST_ASSERT_EQUAL_UINT16(5000u * 65535 / 10000, out.humi);
+    TEST_ASSERT_EQUAL_UINT16(3000, out.batt_mv);
+    TEST_ASSERT_EQUAL_UINT8(9, out.run_counter);
+    TEST_ASSERT_TRUE(out.mac_addr == ATC_MAC);
+}
+
+void test_atc_rejects_foreign_mac()
+{
+    prst_sensor_data_t out;
+    advert_t advert = make_advert(nullptr, 0x181a, ATC1441, sizeof(ATC1441), PARASITE_MAC);
+    TEST_ASSERT_FALSE(advert_decoders::decode(advert, out));
+}
+
+void test_unknown_advert()
+{
+    prst_sensor_data_t out;
+    TEST_ASSERT_FALSE(advert_decoders::decode(make_advert("tv", 0xfe9f, ATC1441, sizeof(ATC1441), ATC_MAC), out));
+    TEST_ASSERT_FALSE(advert_decoders::decode(make_advert(nullptr, 0x181a, ATC1441, 14, ATC_MAC), out));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bparasite_v2);
+    RUN_TEST(test_bparasite_v2_negative_temperature);
+    RUN_TEST(test_bparasite_v2_rejects_missing_light);
+    RUN_TEST(test_bparasite_v1);
+    RUN_TEST(test_bparasite_v1_without_light);
+    RUN_TEST(test_bparasite_v1_rejects_short);
+    RUN_TEST(test_bparasite_needs_name);
+    RUN_TEST(test_bthome_v2);
+    RUN_TEST(test_bthome_v2_rejects_encrypted);
+    RUN_TEST(test_bthome_v2_rejects_short);
+    RUN_TEST(test_bthome_v2_stops_at_unknown_object);
+    RUN_TEST(test_atc1441);
+    RUN_TEST(test_atc_pvvx);
+    RUN_TEST(test_atc_rejects_foreign_mac);
+    RUN_TEST(test_unknown_advert);
+    return UNITY_END();
+}
@@ -0,0 +1,298 @@
+#include <unity.h>
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "peer_codec.h"
+
+// Unit tests for the peer sync packet format and merge rules, and a loopback
+// test that runs three dashboards as separate processes exchanging packets
+// over UDP on 127.0.0.1.
+
+unsigned long millis()
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static prst_sensor_data_t reading(uint8_t id, uint8_t counter, unsigned long timestamp, float temp_c = 20.0f)
+{
+    prst_sensor_data_t sensor;
+    const uint8_t mac[6] = { 0xa4, 0xc1, 0x38, 0x00, 0x00, id };
+    memcpy(sensor.mac_addr.bytes, mac, 6);
+    sensor.protocol = PROTOCOL_BTHOME_V2;
+    sensor.run_counter = counter;
+    sensor.timestamp = timestamp;
+    sensor.temp_c = temp_c;
+    return sensor;
+}
+
+static const prst_sensor_data_t* find(const std::vector<prst_sensor_data_t>& sensors, uint8_t id)
+{
+    for (const auto& sensor : sensors) {
+        if (sensor.mac_addr.bytes[5] == id)
+            return &sensor;
+    }
+    return nullptr;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_record_round_trip()
+{
+    prst_sensor_data_t sent;
+    const uint8_t mac[6] = { 0xf0, 0xca, 0xfe, 0x00, 0x11, 0x22 };
+    memcpy(sent.mac_addr.bytes, mac, 6);
+    sent.protocol = PROTOCOL_BPARASITE_V2;
+    sent.protocol_version = 2;
+    sent.has_light_sensor = true;
+    sent.has_soil_sensor = true;
+    sent.run_counter = 11;
+    sent.batt_mv = 2980;
+    sent.temp_c = -4.25f;
+    sent.humi = 40000;
+    sent.soil_moisture = 12345;
+    sent.light = 300;
+    sent.rssi = -81;
+    sent.timestamp = 100000;
+
+    uint8_t packet[SYNC_PACKET_MAX];
+    size_t len = encodeSyncPacket(packet, { sent }, 103500);
+    TEST_ASSERT_EQUAL(SYNC_HEADER_LEN + SYNC_RECORD_LEN, len);
+
+    // The receiver's clock is unrelated; only the 3.5 s age carries over.
+    std::vector<prst_sensor_data_t> out;
+    TEST_ASSERT_TRUE(decodeSyncPacket(packet, len, 500000, out));
+    TEST_ASSERT_EQUAL(1, out.size());
+    const prst_sensor_data_t& got = out[0];
+    TEST_ASSERT_TRUE(got.mac_addr == sent.mac_addr);
+    TEST_ASSERT_EQUAL(PROTOCOL_BPARASITE_V2, got.protocol);
+    TEST_ASSERT_EQUAL(2, got.protocol_version);
+    TEST_ASSERT_TRUE(got.has_light_sensor);
+    TEST_ASSERT_TRUE(got.has_soil_sensor);
+    TEST_ASSERT_EQUAL(11, got.run_counter);
+    TEST_ASSERT_EQUAL(2980, got.batt_mv);
+    TEST_ASSERT_EQUAL_FLOAT(-4.25f, got.temp_c);
+    TEST_ASSERT_EQUAL(40000, got.humi);
+    TEST_ASSERT_EQUAL(12345, got.soil_moisture);
+    TEST_ASSERT_EQUAL(300, got.light);
+    TEST_ASSERT_EQUAL(-81, got.rssi);
+    TEST_ASSERT_EQUAL(500000 - 3500, got.timestamp);
+}
+
+void test_temperature_rounds()
+{
+    // 0.29f * 100 is just under 29; truncating would send 0.28.
+    uint8_t packet[SYNC_PACKET_MAX];
+    size_t len = encodeSyncPacket(packet, { reading(1, 0, 0, 0.29f), reading(2, 0, 0, -0.29f) }, 0);
+    std::vector<prst_sensor_data_t> out;
+    TEST_ASSERT_TRUE(decodeSyncPacket(packet, len, 0, out));
+    TEST_ASSERT_EQUAL_FLOAT(0.29f, out[0].temp_c);
+    TEST_ASSERT_EQUAL_FLOAT(-0.29f, out[1].temp_c);
+}
+
+void test_packet_is_capped()
+{
+    std::vector<prst_sensor_data_t> readings;
+    for (unsigned i = 0; i < SYNC_MAX_RECORDS + 5; ++i) {
+        readings.push_back(reading(i, 0, 0));
+    }
+    uint8_t packet[SYNC_PACKET_MAX];
+    TEST_ASSERT_EQUAL(SYNC_PACKET_MAX, encodeSyncPacket(packet, readings, 0));
+}
+
+void test_rejects_bad_packets()
+{
+    uint8_t packet[SYNC_PACKET_MAX];
+    size_t len = encodeSyncPacket(packet, { reading(1, 0, 0), reading(2, 0, 0) }, 0);
+    std::vector<prst_sensor_data_t> out;
+    TEST_ASSERT_FALSE(decodeSyncPacket(packet, len - 1, 0, out));
+    TEST_ASSERT_FALSE(decodeSyncPacket(packet, 3, 0, out));
+    packet[4] = 2; // version
+    TEST_ASSERT_FALSE(decodeSyncPacket(packet, len, 0, out));
+    packet[4] = 1;
+    packet[0] = 'X';
+    TEST_ASSERT_FALSE(decodeSyncPacket(packet, len, 0, out));
+    TEST_ASSERT_EQUAL(0, out.size());
+}
+
+void test_same_advert_from_two_dashboards()
+{
+    // Stamped a second apart by two panels: the same reading, either way round.
+    prst_sensor_data_t mine = reading(1, 7, 10000);
+    prst_sensor_data_t theirs = reading(1, 7, 11000);
+    TEST_ASSERT_FALSE(newerReading(theirs, mine));
+    TEST_ASSERT_FALSE(newerReading(mine, theirs));
+}
+
+void test_close_readings_ordered_by_counter()
+{
+    // A relayed reading can look older than ours and still be the next one.
+    prst_sensor_data_t mine = reading(1, 7, 10000);
+    TEST_ASSERT_TRUE(newerReading(reading(1, 8, 9000), mine));
+    TEST_ASSERT_FALSE(newerReading(reading(1, 6, 12000), mine));
+
+    // b-parasite counters are four bits and wrap from 15 to 0.
+    prst_sensor_data_t last = reading(1, 15, 10000);
+    last.protocol = PROTOCOL_BPARASITE_V2;
+    prst_sensor_data_t wrapped = reading(1, 0, 9500);
+    wrapped.protocol = PROTOCOL_BPARASITE_V2;
+    TEST_ASSERT_TRUE(newerReading(wrapped, last));
+    TEST_ASSERT_FALSE(newerReading(last, wrapped));
+}
+
+void test_distant_readings_ordered_by_time()
+{
+    prst_sensor_data_t mine = reading(1, 7, 10000);
+    TEST_ASSERT_TRUE(newerReading(reading(1, 7, 10000 + SAME_READING_MS + 1), mine));
+    TEST_ASSERT_FALSE(newerReading(reading(1, 200, 10000 - SAME_READING_MS - 1), mine));
+}
+
+void test_merge()
+{
+    std::vector<prst_sensor_data_t> sensors = { reading(1, 7, 10000, 20.0f) };
+    TEST_ASSERT_FALSE(mergePeerReading(sensors, reading(1, 7, 10500, 21.0f)));
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, sensors[0].temp_c);
+    TEST_ASSERT_TRUE(mergePeerReading(sensors, reading(1, 8, 10500, 22.0f)));
+    TEST_ASSERT_EQUAL_FLOAT(22.0f, sensors[0].temp_c);
+    TEST_ASSERT_TRUE(mergePeerReading(sensors, reading(2, 0, 10000)));
+    TEST_ASSERT_EQUAL(2, sensors.size());
+}
+
+// One dashboard of the loopback test: send our readings to every other
+// dashboard, merge what they send us, then report the merged registry to the
+// parent over `report` as another sync packet.
+static int run_dashboard(int sock, const std::vector<uint16_t>& ports, size_t self,
+    std::vector<prst_sensor_data_t> sensors, int report)
+{
+    uint8_t packet[SYNC_PACKET_MAX];
+    size_t len = encodeSyncPacket(packet, sensors, millis());
+    for (size_t i = 0; i < ports.size(); ++i) {
+        if (i == self)
+            continue;
+        sockaddr_in to = {};
+        to.sin_family = AF_INET;
+        to.sin_port = htons(ports[i]);
+        to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (sendto(sock, packet, len, 0, (sockaddr*)&to, sizeof(to)) != (ssize_t)len)
+            return 1;
+    }
+
+    timeval timeout = { 5, 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    for (size_t heard = 0; heard + 1 < ports.size(); ++heard) {
+        ssize_t got = recv(sock, packet, sizeof(packet), 0);
+        if (got < 0)
+            return 1;
+        std::vector<prst_sensor_data_t> relayed;
+        if (!decodeSyncPacket(packet, got, millis(), relayed))
+            return 1;
+        for (const auto& sensor : relayed) {
+            mergePeerReading(sensors, sensor);
+        }
+    }
+
+    len = encodeSyncPacket(packet, sensors, millis());
+    return write(report, packet, len) == (ssize_t)len ? 0 : 1;
+}
+
+void test_loopback_dashboards()
+{
+    const size_t DASHBOARDS = 3;
+    unsigned long now = millis();
+
+    // Sensor 1 is heard by every panel within a few hundred ms, sensor 2 by
+    // panels 0 and 1 on consecutive adverts, and sensor 10 + i by panel i alone.
+    std::vector<std::vector<prst_sensor_data_t>> local(DASHBOARDS);
+    for (size_t i = 0; i < DASHBOARDS; ++i) {
+        local[i].push_back(reading(1, 42, now - 300 * i, 20.0f));
+        local[i].push_back(reading(10 + i, 1, now - 1000, 10.0f + i));
+    }
+    local[0].push_back(reading(2, 5, now - 500, 15.0f));
+    local[1].push_back(reading(2, 6, now - 2000, 16.0f));
+
+    // Bind every socket before forking, so no packet can arrive early.
+    std::vector<int> socks;
+    std::vector<uint16_t> ports;
+    for (size_t i = 0; i < DASHBOARDS; ++i) {
+        int sock = socket(AF_INET, SOCK_DGRAM, 0);
+        TEST_ASSERT_TRUE(sock >= 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        TEST_ASSERT_EQUAL(0, bind(sock, (sockaddr*)&addr, sizeof(addr)));
+        socklen_t addr_len = sizeof(addr);
+        getsockname(sock, (sockaddr*)&addr, &addr_len);
+        socks.push_back(sock);
+        ports.push_back(ntohs(addr.sin_port));
+    }
+
+    std::vector<pid_t> children;
+    std::vector<int> reports;
+    for (size_t i = 0; i < DASHBOARDS; ++i) {
+        int pipe_fds[2];
+        TEST_ASSERT_EQUAL(0, pipe(pipe_fds));
+        pid_t pid = fork();
+        TEST_ASSERT_TRUE(pid >= 0);
+        if (pid == 0) {
+            close(pipe_fds[0]);
+            _exit(run_dashboard(socks[i], ports, i, local[i], pipe_fds[1]));
+        }
+        close(pipe_fds[1]);
+        children.push_back(pid);
+        reports.push_back(pipe_fds[0]);
+    }
+
+    for (size_t i = 0; i < DASHBOARDS; ++i) {
+        int status;
+        waitpid(children[i], &status, 0);
+        TEST_ASSERT_TRUE_MESSAGE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "dashboard process failed");
+
+        uint8_t packet[SYNC_PACKET_MAX];
+        ssize_t len = read(reports[i], packet, sizeof(packet));
+        close(reports[i]);
+        close(socks[i]);
+        std::vector<prst_sensor_data_t> merged;
+        TEST_ASSERT_TRUE(decodeSyncPacket(packet, len > 0 ? len : 0, millis(), merged));
+
+        // Every panel ends up with every sensor, and the same reading of each.
+        TEST_ASSERT_EQUAL(2 + DASHBOARDS, merged.size());
+        TEST_ASSERT_EQUAL(42, find(merged, 1)->run_counter);
+        TEST_ASSERT_EQUAL(6, find(merged, 2)->run_counter);
+        TEST_ASSERT_EQUAL_FLOAT(16.0f, find(merged, 2)->temp_c);
+        for (size_t j = 0; j < DASHBOARDS; ++j) {
+            TEST_ASSERT_NOT_NULL(find(merged, 10 + j));
+            TEST_ASSERT_EQUAL_FLOAT(10.0f + j, find(merged, 10 + j)->temp_c);
+        }
+        // Panels keep their own copy of a reading they heard themselves.
+        if (i == 2)
+            TEST_ASSERT_TRUE(find(merged, 1)->timestamp <= now - 500);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_record_round_trip);
+    RUN_TEST(test_temperature_rounds);
+    RUN_TEST(test_packet_is_capped);
+    RUN_TEST(test_rejects_bad_packets);
+    RUN_TEST(test_same_advert_from_two_dashboards);
+    RUN_TEST(test_close_readings_ordered_by_counter);
+    RUN_TEST(test_distant_readings_ordered_by_time);
+    RUN_TEST(test_merge);
+    RUN_TEST(test_loopback_dashboards);
+    return UNITY_END();
+}
@@ -0,0 +1,212 @@
+#include <unity.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "render.h"
+#include "widgets.h"
+
+// Golden image tests for the dashboard widgets, drawn by the host backend
+// with the font shipped on the SD card. Each widget's block is compared with
+// golden/<name>.pgm. Run with RENDER_UPDATE_GOLDEN=1 to rewrite the goldens
+// after an intentional layout change; on a mismatch the rendering is written
+// next to the golden as <name>.actual.pgm.
+
+extern std::string FONT_FACE;
+
+unsigned long millis()
+{
+    return 0;
+}
+
+struct rect_t {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+static std::string test_dir()
+{
+    std::string file = __FILE__;
+    size_t slash = file.find_last_of('/');
+    return slash == std::string::npos ? std::string(".") : file.substr(0, slash);
+}
+
+// Crop of the framebuffer as PGM pixels: 0 = black, 15 = white.
+static std::vector<uint8_t> crop(const rect_t& rect)
+{
+    const uint8_t* fb = renderSnapshot();
+    std::vector<uint8_t> pixels;
+    pixels.reserve(rect.width * rect.height);
+    for (int y = rect.y; y < rect.y + rect.height; ++y) {
+        for (int x = rect.x; x < rect.x + rect.width; ++x) {
+            uint8_t byte = fb[(y * SCREEN_WIDTH + x) / 2];
+            pixels.push_back(15 - ((x & 1) ? byte & 0x0f : byte >> 4));
+        }
+    }
+    return pixels;
+}
+
+static bool write_pgm(const std::string& path, const rect_t& rect, const std::vector<uint8_t>& pixels)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    fprintf(file, "P5\n%d %d\n15\n", rect.width, rect.height);
+    fwrite(pixels.data(), 1, pixels.size(), file);
+    return fclose(file) == 0;
+}
+
+static bool read_pgm(const std::string& path, const rect_t& rect, std::vector<uint8_t>& pixels)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+    int width, height, maxval;
+    bool ok = fscanf(file, "P5 %d %d %d", &width, &height, &maxval) == 3 && fgetc(file) != EOF && width == rect.width
+        && height == rect.height && maxval == 15;
+    if (ok) {
+        pixels.resize(width * height);
+        ok = fread(pixels.data(), 1, pixels.size(), file) == pixels.size();
+    }
+    fclose(file);
+    return ok;
+}
+
+// FreeType versions differ slightly in antialiasing, so a golden matches when
+// at most 0.5% of the pixels are off by more than one grey level.
+static void check_golden(const char* name, const rect_t& rect)
+{
+    std::vector<uint8_t> actual = crop(rect);
+    std::string golden = test_dir() + "/golden/" + name + ".pgm";
+    if (getenv("RENDER_UPDATE_GOLDEN") != nullptr) {
+        TEST_ASSERT_TRUE_MESSAGE(write_pgm(golden, rect, actual), golden.c_str());
+        return;
+    }
+
+    std::vector<uint8_t> expected;
+    TEST_ASSERT_TRUE_MESSAGE(read_pgm(golden, rect, expected), ("missing or bad golden " + golden).c_str());
+    size_t differing = 0;
+    for (size_t i = 0; i < actual.size(); ++i) {
+        if (abs(actual[i] - expected[i]) > 1)
+            ++differing;
+    }
+    if (differing * 200 > actual.size()) {
+        std::string path = test_dir() + "/golden/" + name + ".actual.pgm";
+        write_pgm(path, rect, actual);
+        char message[160];
+        snprintf(message, sizeof(message), "%zu of %zu pixels differ from %s.pgm, see %s", differing, actual.size(),
+            name, path.c_str());
+        TEST_FAIL_MESSAGE(message);
+    }
+}
+
+static bool has_ink(const rect_t& rect)
+{
+    std::vector<uint8_t> pixels = crop(rect);
+    for (uint8_t pixel : pixels) {
+        if (pixel != pixels[0])
+            return true;
+    }
+    return false;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_font_loads()
+{
+    // Without the TTF every block would be a flat fill and the goldens would
+    // test nothing.
+    drawRow("Ag", 0);
+    TEST_ASSERT_TRUE_MESSAGE(has_ink({ 0, 0, 100, 60 }), FONT_FACE.c_str());
+}
+
+void test_row()
+{
+    drawRow("Kitchen basil  — 42%, 71.2°F, 55.0%RH", 200);
+    check_golden("row", { 0, 200, SCREEN_WIDTH, 60 });
+}
+
+// The longest rows, with light data, must stop short of the indicator.
+static const char* LONG_SENSOR_ROW = "Kitchen window basil  —  46%, 101.3°F, 61.0%RH, 23456lux";
+
+void test_sensor_row()
+{
+    drawSensorRow(LONG_SENSOR_ROW, " -72  5%", 265, 15);
+    check_golden("sensor_row", { 0, 265, SCREEN_WIDTH, 60 });
+}
+
+void test_sensor_row_leaves_indicator_column()
+{
+    drawSensorRow(LONG_SENSOR_ROW, "", 330, 15);
+    TEST_ASSERT_TRUE(has_ink({ 0, 330, SCREEN_WIDTH - 130, 60 }));
+    TEST_ASSERT_FALSE(has_ink({ SCREEN_WIDTH - 130, 330, 130, 60 }));
+}
+
+void test_header()
+{
+    drawHeader("Devices", 65, 0, 10);
+    check_golden("header", { 0, 65, SCREEN_WIDTH, 60 });
+}
+
+void test_datetime()
+{
+    drawDateTime("2024/03/09 (Sat) 14:05");
+    check_golden("datetime", { 20, 0, 800, 60 });
+}
+
+void test_battery()
+{
+    drawBattery("\xef\x95\xbe"); // 60-70%
+    check_golden("battery", { SCREEN_WIDTH - 45, 0, 40, 60 });
+}
+
+void test_device_counts()
+{
+    drawDeviceCounts(17, 4);
+    check_golden("counts", { SCREEN_WIDTH - 405, 85, 400, 30 });
+}
+
+void test_render_metrics()
+{
+    const render_stats_t* stats;
+    size_t widgets = renderStats(&stats);
+    TEST_ASSERT_GREATER_THAN(0, widgets);
+    for (size_t i = 0; i < widgets; ++i) {
+        TEST_ASSERT_GREATER_THAN(0, stats[i].calls);
+        char message[96];
+        snprintf(message, sizeof(message), "%-12s %u calls, %u us avg, %u us max", stats[i].widget,
+            (unsigned)stats[i].calls, (unsigned)(stats[i].total_us / stats[i].calls), (unsigned)stats[i].max_us);
+        TEST_MESSAGE(message);
+    }
+}
+
+int main()
+{
+    FONT_FACE = test_dir() + "/../../card_skeleton/monofur_nf.ttf";
+
+    UNITY_BEGIN();
+    RUN_TEST(test_font_loads);
+    RUN_TEST(test_row);
+    RUN_TEST(test_sensor_row);
+    RUN_TEST(test_sensor_row_leaves_indicator_column);
+    RUN_TEST(test_header);
+    RUN_TEST(test_datetime);
+    RUN_TEST(test_battery);
+    RUN_TEST(test_device_counts);
+    RUN_TEST(test_render_metrics);
+    int failures = UNITY_END();
+    // Keep the whole frame around so failures can be seen in context.
+    if (failures)
+        writeRenderSnapshot((test_dir() + "/golden/dashboard.actual.pgm").c_str());
+    return failures;
+}
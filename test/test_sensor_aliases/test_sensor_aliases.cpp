@@ -0,0 +1,135 @@
+#include <unity.h>
+
+#include <cstdio>
+#include <map>
+#include <string>
+
+#include "sensor_aliases.h"
+
+unsigned long millis()
+{
+    return 0;
+}
+
+static std::string mac_str(uint64_t mac)
+{
+    char str[18];
+    snprintf(str, sizeof(str), "%02x-%02x-%02x-%02x-%02x-%02x", (unsigned)(mac >> 40 & 0xff),
+        (unsigned)(mac >> 32 & 0xff), (unsigned)(mac >> 24 & 0xff), (unsigned)(mac >> 16 & 0xff),
+        (unsigned)(mac >> 8 & 0xff), (unsigned)(mac & 0xff));
+    return str;
+}
+
+// Keys 10, 20, .. spaced so that every gap has a miss in it.
+static std::map<std::string, std::string> spaced_keys(size_t count)
+{
+    std::map<std::string, std::string> names;
+    for (size_t i = 1; i <= count; ++i) {
+        names[mac_str(i * 10)] = "sensor " + std::to_string(i * 10);
+    }
+    return names;
+}
+
+static void check_spaced_table(size_t count)
+{
+    SensorAliasTable table;
+    table.build(spaced_keys(count));
+    TEST_ASSERT_EQUAL(count, table.size());
+    TEST_ASSERT_EQUAL(SensorAliasTable::NO_ALIAS, table.find(0));
+    TEST_ASSERT_EQUAL(SensorAliasTable::NO_ALIAS, table.find(5));
+    for (size_t i = 1; i <= count; ++i) {
+        uint16_t id = table.find(i * 10);
+        TEST_ASSERT_NOT_EQUAL(SensorAliasTable::NO_ALIAS, id);
+        TEST_ASSERT_EQUAL_STRING(("sensor " + std::to_string(i * 10)).c_str(), table.name(id));
+        TEST_ASSERT_EQUAL(SensorAliasTable::NO_ALIAS, table.find(i * 10 + 5));
+    }
+    TEST_ASSERT_EQUAL(SensorAliasTable::NO_ALIAS, table.find(0xffffffffffffull));
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_empty_table()
+{
+    SensorAliasTable table;
+    table.build({});
+    TEST_ASSERT_EQUAL(0, table.size());
+    TEST_ASSERT_EQUAL(SensorAliasTable::NO_ALIAS, table.find(0));
+    TEST_ASSERT_EQUAL(SensorAliasTable::NO_ALIAS, table.find(0xf0cafe001122ull));
+    TEST_ASSERT_NULL(table.name(0));
+}
+
+void test_single_entry()
+{
+    check_spaced_table(1);
+}
+
+void test_non_power_of_two()
+{
+    // Padded to 8 slots; the padding must never match.
+    check_spaced_table(5);
+}
+
+void test_power_of_two()
+{
+    check_spaced_table(8);
+}
+
+void test_large_table()
+{
+    check_spaced_table(3000);
+}
+
+void test_parses_both_spellings()
+{
+    SensorAliasTable table;
+    table.build({ { "f0:ca:fe:00:11:22", "colons" }, { "A4-C1-38-0A-0B-0C", "upper" }, { "garbage", "skipped" },
+        { "f0-ca-fe-00-11", "short" } });
+    TEST_ASSERT_EQUAL(2, table.size());
+    TEST_ASSERT_EQUAL_STRING("colons", table.name(table.find(0xf0cafe001122ull)));
+    TEST_ASSERT_EQUAL_STRING("upper", table.name(table.find(0xa4c1380a0b0cull)));
+}
+
+void test_duplicate_spellings()
+{
+    // Both parse to the same MAC. "AA:.." sorts first in the map and wins.
+    SensorAliasTable table;
+    table.build(
+        { { "aa-bb-cc-dd-ee-ff", "dashes" }, { "AA:BB:CC:DD:EE:FF", "colons" }, { "aa-bb-cc-dd-ee-fe", "next" } });
+    TEST_ASSERT_EQUAL(2, table.size());
+    TEST_ASSERT_EQUAL_STRING("colons", table.name(table.find(0xaabbccddeeffull)));
+    TEST_ASSERT_EQUAL_STRING("next", table.name(table.find(0xaabbccddeefeull)));
+}
+
+void test_capped_at_no_alias()
+{
+    // Ids are 16 bits with NO_ALIAS reserved, so the highest key is dropped.
+    std::map<std::string, std::string> names;
+    for (uint64_t mac = 0; mac <= SensorAliasTable::NO_ALIAS; ++mac) {
+        names[mac_str(mac)] = "x";
+    }
+    SensorAliasTable table;
+    table.build(names);
+    TEST_ASSERT_EQUAL(SensorAliasTable::NO_ALIAS, table.size());
+    TEST_ASSERT_EQUAL(SensorAliasTable::NO_ALIAS - 1, table.find(SensorAliasTable::NO_ALIAS - 1));
+    TEST_ASSERT_EQUAL(SensorAliasTable::NO_ALIAS, table.find(SensorAliasTable::NO_ALIAS));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_table);
+    RUN_TEST(test_single_entry);
+    RUN_TEST(test_non_power_of_two);
+    RUN_TEST(test_power_of_two);
+    RUN_TEST(test_large_table);
+    RUN_TEST(test_parses_both_spellings);
+    RUN_TEST(test_duplicate_spellings);
+    RUN_TEST(test_capped_at_no_alias);
+    return UNITY_END();
+}
@@ -0,0 +1,89 @@
+#include <unity.h>
+
+#include "sensor_stats.h"
+
+unsigned long millis()
+{
+    return 0;
+}
+
+static prst_sensor_data_t reading(uint8_t counter, unsigned long timestamp, float temp_c = 20.0f)
+{
+    prst_sensor_data_t sensor;
+    sensor.protocol = PROTOCOL_BTHOME_V2;
+    sensor.run_counter = counter;
+    sensor.timestamp = timestamp;
+    sensor.temp_c = temp_c;
+    sensor.rssi = -70;
+    return sensor;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_repeats_are_not_samples()
+{
+    // The scanner may report the same advert more than once.
+    SensorStats stats;
+    stats.add(reading(1, 0));
+    stats.add(reading(1, 100));
+    stats.add(reading(2, 10000));
+    stats.add(reading(2, 10100));
+    TEST_ASSERT_EQUAL(2, stats.samples());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.loss_rate());
+}
+
+void test_counter_gaps_are_loss()
+{
+    SensorStats stats;
+    stats.add(reading(1, 0));
+    stats.add(reading(2, 10000));
+    stats.add(reading(5, 40000)); // 3 and 4 were missed
+    TEST_ASSERT_EQUAL(3, stats.samples());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 2.0f / 5.0f, stats.loss_rate());
+}
+
+void test_counter_wraps()
+{
+    SensorStats stats;
+    stats.add(reading(254, 0));
+    stats.add(reading(255, 10000));
+    stats.add(reading(0, 20000));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.loss_rate());
+}
+
+void test_window_is_a_sample_count()
+{
+    SensorStats stats;
+    for (unsigned i = 0; i < 100; ++i) {
+        stats.add(reading(i, i * 10000ul, i < 36 ? 30.0f : 20.0f));
+    }
+    TEST_ASSERT_EQUAL(SensorStats::WINDOW_SAMPLES, stats.samples());
+    // The hot readings are older than the last 64 and have left the window.
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, stats.temp_max());
+}
+
+void test_window_drops_old_readings()
+{
+    SensorStats stats;
+    stats.add(reading(1, 0, 30.0f));
+    stats.add(reading(2, SensorStats::WINDOW_MS + 1000, 20.0f));
+    TEST_ASSERT_EQUAL(1, stats.samples());
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, stats.temp_max());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_repeats_are_not_samples);
+    RUN_TEST(test_counter_gaps_are_loss);
+    RUN_TEST(test_counter_wraps);
+    RUN_TEST(test_window_is_a_sample_count);
+    RUN_TEST(test_window_drops_old_readings);
+    return UNITY_END();
+}
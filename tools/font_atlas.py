@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""Pre-rasterize a TrueType font into an antialiased 4bpp glyph atlas.
+
+The atlas is loaded once at boot (see src/bitmap_font.h) so the dashboard can
+draw text without rasterizing the TTF on the ESP32.
+
+    pip install freetype-py
+    tools/font_atlas.py card_skeleton/monofur_nf.ttf card_skeleton/monofur_nf.m5fa \\
+        --sizes 30,45,50,60 --scan src
+
+File layout, all little-endian and 4-byte aligned:
+
+    header   magic "M5FA", u16 version, u16 strike count
+    strike   u16 size, i16 ascent, i16 descent, u16 glyph count, u16 kern count,
+             u16 reserved, u32 glyph table, u32 kern table, u32 bitmaps
+    glyph    u32 codepoint, u8 width, u8 height, i8 left, i8 top, u8 advance,
+             u8[3] reserved, u32 bitmap offset (relative to the strike bitmaps)
+    kern     u16 left, u16 right, i16 adjust, u16 reserved
+
+Glyphs and kerning pairs are sorted for binary search. Bitmaps are rows of
+(width + 1) / 2 bytes, left pixel in the high nibble, 0 = no coverage.
+"""
+
+import argparse
+import glob
+import os
+import struct
+import sys
+
+import freetype
+
+MAGIC = b"M5FA"
+VERSION = 1
+HEADER = struct.Struct("<4sHH")
+STRIKE = struct.Struct("<HhhHHHIII")
+GLYPH = struct.Struct("<IBBbbB3xI")
+KERN = struct.Struct("<HHhxx")
+
+
+def scan_codepoints(paths):
+    codepoints = set()
+    for path in paths:
+        files = [path]
+        if os.path.isdir(path):
+            files = glob.glob(os.path.join(path, "*.cpp")) + glob.glob(os.path.join(path, "*.h"))
+        for name in files:
+            with open(name, encoding="utf-8") as f:
+                codepoints.update(ord(ch) for ch in f.read() if ord(ch) > 127)
+    return codepoints
+
+
+def pack_4bpp(bitmap):
+    width, rows, pitch = bitmap.width, bitmap.rows, bitmap.pitch
+    out = bytearray()
+    for y in range(rows):
+        row = bitmap.buffer[y * pitch : y * pitch + width]
+        levels = [(v * 15 + 127) // 255 for v in row]
+        if width % 2:
+            levels.append(0)
+        for x in range(0, len(levels), 2):
+            out.append(levels[x] << 4 | levels[x + 1])
+    return bytes(out)
+
+
+def build_strike(face, size, codepoints):
+    face.set_pixel_sizes(0, size)
+    glyphs = []
+    bitmaps = bytearray()
+    for cp in sorted(codepoints):
+        index = face.get_char_index(cp)
+        if index == 0:
+            continue
+        face.load_glyph(index, freetype.FT_LOAD_RENDER | freetype.FT_LOAD_TARGET_NORMAL)
+        slot = face.glyph
+        bitmap = slot.bitmap
+        if bitmap.width > 255 or bitmap.rows > 255 or not (-128 <= slot.bitmap_left < 128 and -128 <= slot.bitmap_top < 128):
+            sys.exit("glyph U+%04X is too large at size %d" % (cp, size))
+        advance = (slot.advance.x + 32) >> 6
+        glyphs.append((cp, bitmap.width, bitmap.rows, slot.bitmap_left, slot.bitmap_top, min(advance, 255), len(bitmaps)))
+        bitmaps += pack_4bpp(bitmap)
+
+    kerns = []
+    if face.has_kerning:
+        present = [g[0] for g in glyphs if g[0] <= 0xFFFF]
+        for left in present:
+            for right in present:
+                delta = face.get_kerning(face.get_char_index(left), face.get_char_index(right))
+                adjust = (delta.x + 32) >> 6
+                if adjust:
+                    kerns.append((left, right, adjust))
+
+    metrics = face.size
+    ascent = (metrics.ascender + 63) >> 6
+    descent = (-metrics.descender + 63) >> 6
+    return ascent, descent, glyphs, kerns, bytes(bitmaps)
+
+
+def align4(data):
+    return data + b"\0" * (-len(data) % 4)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("font", help="TrueType font to rasterize")
+    parser.add_argument("output", help="atlas file to write")
+    parser.add_argument("--sizes", default="30,45,50,60", help="comma separated pixel sizes")
+    parser.add_argument("--chars", default="", help="extra characters to include")
+    parser.add_argument("--scan", nargs="*", default=[], help="source files or directories to collect non-ASCII characters from")
+    args = parser.parse_args()
+
+    codepoints = set(range(0x20, 0x7F))
+    codepoints.update(ord(ch) for ch in args.chars)
+    codepoints.update(scan_codepoints(args.scan))
+
+    face = freetype.Face(args.font)
+    missing = sorted(cp for cp in codepoints if face.get_char_index(cp) == 0)
+    for cp in missing:
+        print("warning: U+%04X is not in %s" % (cp, args.font), file=sys.stderr)
+
+    sizes = [int(s) for s in args.sizes.split(",")]
+    strikes = [build_strike(face, size, codepoints) for size in sizes]
+
+    # Lay out the header and strike table, then each strike's tables.
+    offset = HEADER.size + STRIKE.size * len(strikes)
+    strike_table = b""
+    body = b""
+    for size, (ascent, descent, glyphs, kerns, bitmaps) in zip(sizes, strikes):
+        glyph_data = b"".join(GLYPH.pack(*g) for g in glyphs)
+        kern_data = b"".join(KERN.pack(*k) for k in kerns)
+        glyph_offset = offset + len(body)
+        body += align4(glyph_data)
+        kern_offset = offset + len(body)
+        body += align4(kern_data)
+        bitmap_offset = offset + len(body)
+        body += align4(bitmaps)
+        strike_table += STRIKE.pack(size, ascent, descent, len(glyphs), len(kerns), 0, glyph_offset, kern_offset, bitmap_offset)
+
+    with open(args.output, "wb") as f:
+        f.write(HEADER.pack(MAGIC, VERSION, len(strikes)))
+        f.write(strike_table)
+        f.write(body)
+
+    total = HEADER.size + len(strike_table) + len(body)
+    print("%s: %d strikes, %d glyphs each, %d bytes" % (args.output, len(strikes), len(strikes[0][2]), total))
+
+
+if __name__ == "__main__":
+    main()